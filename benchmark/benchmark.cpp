@@ -0,0 +1,518 @@
+/**
+ * Throughput and latency of the frame codec and of a CommHandle, without
+ * hardware: the codec runs over in-memory streams, CommHandles over a
+ * pseudo terminal whose master side either drains or echoes every byte,
+ * like a loopback plug on a real port.
+ *
+ *     benchmark [--quick] [--seconds S] [filter...]
+ *
+ * Every measurement is printed as one JSON object per line. A filter
+ * keeps the cases whose "benchmark/transport" name contains it.
+ */
+
+#include "serial/CommHandle.hpp"
+#include "serial/LinkStatistics.hpp"
+#include "serial/Reactor.hpp"
+#include "serial/command/CRC.hpp"
+#include "serial/command/Cobs.hpp"
+#include "serial/command/CommandFrame.hpp"
+#include "serial/command/DispatchTable.hpp"
+#include "serial/command/FrameDecoder.hpp"
+#include "serial/command/FramePool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <poll.h>
+#include <pty.h>
+#include <unistd.h>
+
+#define func auto
+
+using namespace serial;
+using namespace serial::command;
+using namespace std::literals::chrono_literals;
+
+using Clock = std::chrono::steady_clock;
+
+template <size_t N>
+struct Payload
+{
+    byte_t bytes[N];
+};
+
+template <size_t N>
+using Size = std::integral_constant<size_t, N>;
+
+static constexpr uint16_t COMMAND = 0x0042;
+
+struct Settings
+{
+    double seconds = 0.25;
+    std::vector<std::string> filters;
+};
+
+static Settings settings;
+
+static volatile uint64_t sink;
+
+static func selected(const char* benchmark, const char* transport) -> bool
+{
+    if (settings.filters.empty()) {
+        return true;
+    }
+    std::string name = std::string(benchmark) + "/" + transport;
+    for (const auto & filter : settings.filters) {
+        if (name.find(filter) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Function>
+static func forEachPayload(Function && function) -> void
+{
+    function(Size<4>());
+    function(Size<16>());
+    function(Size<64>());
+    function(Size<256>());
+    function(Size<1024>());
+    function(Size<4096>());
+    function(Size<16384>());
+}
+
+static func elapsed(Clock::time_point start) -> double
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static func nanosecondsSince(Clock::time_point start) -> uint64_t
+{
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+/**
+ * Run `step` in batches of `batch` until the time budget is spent
+ * @return operations run and seconds taken
+ */
+template <typename Step>
+static func measure(Step && step, size_t batch = 64) -> std::pair<uint64_t, double>
+{
+    uint64_t operations = 0;
+    Clock::time_point start = Clock::now();
+    double seconds;
+    do {
+        for (size_t i = 0; i < batch; i++) {
+            step();
+        }
+        operations += batch;
+    } while ((seconds = elapsed(start)) < settings.seconds);
+    return { operations, seconds };
+}
+
+static func report(const char* benchmark, const char* transport, size_t payload, size_t bytesPerOperation,
+                   uint64_t operations, double seconds, const LatencyHistogram* latency = nullptr) -> void
+{
+    std::printf(
+        "{\"benchmark\":\"%s\",\"transport\":\"%s\",\"payload\":%zu,\"operations\":%llu,"
+        "\"seconds\":%.6f,\"ops_per_s\":%.1f,\"mb_per_s\":%.3f",
+        benchmark, transport, payload, (unsigned long long) operations,
+        seconds, (double) operations / seconds, (double) (operations * bytesPerOperation) / seconds / 1e6
+    );
+    if (latency != nullptr) {
+        LatencyHistogram::Snapshot snapshot = latency->snapshot();
+        std::printf(
+            ",\"mean_ns\":%.0f,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu",
+            snapshot.mean(),
+            (unsigned long long) snapshot.percentile(50),
+            (unsigned long long) snapshot.percentile(90),
+            (unsigned long long) snapshot.percentile(99),
+            (unsigned long long) snapshot.percentile(99.9),
+            (unsigned long long) snapshot.max
+        );
+    }
+    std::printf("}\n");
+    std::fflush(stdout);
+}
+
+template <size_t N>
+static func makePayload() -> Payload<N>
+{
+    Payload<N> data {};
+    for (size_t i = 0; i < N; i++) {
+        data.bytes[i] = (byte_t) (i * 31 + 7);
+    }
+    return data;
+}
+
+/**
+ * Encoded frames back to back, at least 64 of them and about 1 MiB
+ */
+template <size_t N>
+static func makeStream() -> std::vector<byte_t>
+{
+    const size_t frameSize = CommandFrame<Payload<N>>::frameSize();
+    size_t count = std::max<size_t>(64, (1 << 20) / frameSize);
+    std::vector<byte_t> stream(count * frameSize);
+    Payload<N> data = makePayload<N>();
+    for (size_t i = 0; i < count; i++) {
+        CommandFrame<Payload<N>>(COMMAND, data).encode(stream.data() + i * frameSize, frameSize);
+    }
+    return stream;
+}
+
+static func benchmarkEncode() -> void
+{
+    if (!selected("encode", "memory")) {
+        return;
+    }
+    forEachPayload([](auto size) {
+        constexpr size_t N = decltype(size)::value;
+        using Frame = CommandFrame<Payload<N>>;
+        Payload<N> data = makePayload<N>();
+        std::vector<byte_t> buffer(Frame::frameSize());
+
+        auto [operations, seconds] = measure([&] {
+            sink += Frame(COMMAND, data).encode(buffer.data(), buffer.size());
+        });
+        report("encode", "memory", N, Frame::frameSize(), operations, seconds);
+    });
+}
+
+static func benchmarkDecode() -> void
+{
+    const bool plain = selected("decode", "memory");
+    const bool pooled = selected("decode_pooled", "memory");
+    if (!plain && !pooled) {
+        return;
+    }
+    forEachPayload([&](auto size) {
+        constexpr size_t N = decltype(size)::value;
+        const size_t frameSize = CommandFrame<Payload<N>>::frameSize();
+        std::vector<byte_t> stream = makeStream<N>();
+        const size_t frames = stream.size() / frameSize;
+        const size_t SPAN = 4096;  // a typical read, frames get cut at span ends
+
+        FramePool pool({ 64, N });
+        for (int usePool = 0; usePool < 2; usePool++) {
+            if (!(usePool ? pooled : plain)) {
+                continue;
+            }
+            FrameDecoder decoder(0xA5, UINT16_MAX, usePool ? &pool : nullptr);
+            auto [operations, seconds] = measure([&] {
+                for (size_t offset = 0; offset < stream.size(); offset += SPAN) {
+                    size_t length = std::min(SPAN, stream.size() - offset);
+                    decoder.decode(stream.data() + offset, length, [](const FrameView & frame) {
+                        sink += frame.dataLength;
+                    });
+                }
+            }, 1);
+            report(usePool ? "decode_pooled" : "decode", "memory", N, frameSize, operations * frames, seconds);
+        }
+    });
+}
+
+/**
+ * COBS framing: encoding a frame and decoding a stream of them, with
+ * the same spans and pool as `decode_pooled`
+ */
+static func benchmarkCobs() -> void
+{
+    const bool encode = selected("encode_cobs", "memory");
+    const bool decode = selected("decode_cobs", "memory");
+    if (!encode && !decode) {
+        return;
+    }
+    forEachPayload([&](auto size) {
+        constexpr size_t N = decltype(size)::value;
+        using Frame = CommandFrame<Payload<N>>;
+        Payload<N> data = makePayload<N>();
+        std::vector<byte_t> encoded(Cobs::maxEncodedSize(Frame::frameSize()) + 1);
+        size_t wireSize = 0;
+
+        if (encode) {
+            auto [operations, seconds] = measure([&] {
+                Frame frame(COMMAND, data);
+                wireSize = Cobs::encode((const byte_t*) &frame.getRawFrame(), Frame::frameSize(), encoded.data()) + 1;
+                encoded[wireSize - 1] = Cobs::DELIMITER;
+                sink += wireSize;
+            });
+            report("encode_cobs", "memory", N, wireSize, operations, seconds);
+        }
+        if (!decode) {
+            return;
+        }
+
+        std::vector<byte_t> stream;
+        size_t frames = std::max<size_t>(64, (1 << 20) / Frame::frameSize());
+        for (size_t i = 0; i < frames; i++) {
+            Frame frame(COMMAND, data);
+            wireSize = Cobs::encode((const byte_t*) &frame.getRawFrame(), Frame::frameSize(), encoded.data());
+            stream.insert(stream.end(), encoded.begin(), encoded.begin() + (long) wireSize);
+            stream.push_back(Cobs::DELIMITER);
+        }
+        const size_t SPAN = 4096;
+
+        FramePool pool({ 64, N });
+        FrameDecoder decoder(0xA5, UINT16_MAX, &pool);
+        decoder.setFraming(Framing::COBS);
+        auto [operations, seconds] = measure([&] {
+            for (size_t offset = 0; offset < stream.size(); offset += SPAN) {
+                size_t length = std::min(SPAN, stream.size() - offset);
+                decoder.decode(stream.data() + offset, length, [](const FrameView & frame) {
+                    sink += frame.dataLength;
+                });
+            }
+        }, 1);
+        report("decode_cobs", "memory", N, wireSize + 1, operations * frames, seconds);
+    });
+}
+
+template <typename Compute>
+static func benchmarkCrc(const char* algorithm, Compute compute) -> void
+{
+    if (!selected(algorithm, "memory")) {
+        return;
+    }
+    forEachPayload([&](auto size) {
+        constexpr size_t N = decltype(size)::value;
+        Payload<N> data = makePayload<N>();
+        auto [operations, seconds] = measure([&] {
+            sink += compute(data.bytes, N);
+        });
+        report(algorithm, "memory", N, N, operations, seconds);
+    });
+}
+
+static func benchmarkCrcs() -> void
+{
+    using Crc8 = CommandFrameUtils::Crc8;
+    using Crc16 = CommandFrameUtils::Crc16;
+
+    benchmarkCrc("crc8", [](const byte_t* data, size_t length) { return Crc8::compute(data, length); });
+    benchmarkCrc("crc8_table", &Crc8::computeTable);
+    benchmarkCrc("crc8_bitwise", &Crc8::computeBitwise);
+    benchmarkCrc("crc16", [](const byte_t* data, size_t length) { return Crc16::compute(data, length); });
+    benchmarkCrc("crc16_table", &Crc16::computeTable);
+    benchmarkCrc("crc16_bitwise", &Crc16::computeBitwise);
+    if (CrcFolding::available) {
+        benchmarkCrc("crc8_folded", &Crc8::computeFolded);
+        benchmarkCrc("crc16_folded", &Crc16::computeFolded);
+    }
+}
+
+/**
+ * Encode, decode and dispatch one frame at a time, the latency a
+ * CommHandle adds on top of the transport
+ */
+static func benchmarkMemoryRoundTrip() -> void
+{
+    if (!selected("end_to_end", "memory")) {
+        return;
+    }
+    forEachPayload([](auto size) {
+        constexpr size_t N = decltype(size)::value;
+        using Frame = CommandFrame<Payload<N>>;
+        Payload<N> data = makePayload<N>();
+        std::vector<byte_t> buffer(Frame::frameSize());
+
+        FramePool pool({ 64, N });
+        FrameDecoder decoder(0xA5, UINT16_MAX, &pool);
+        DispatchTable table;
+        Clock::time_point received;
+        table.set(COMMAND, [](void* target, const FrameView &) {
+            *static_cast<Clock::time_point*>(target) = Clock::now();
+        }, &received, sizeof(Payload<N>));
+
+        LatencyHistogram latency;
+        auto [operations, seconds] = measure([&] {
+            Clock::time_point start = Clock::now();
+            Frame(COMMAND, data).encode(buffer.data(), buffer.size());
+            decoder.decode(buffer.data(), buffer.size(), [&](const FrameView & frame) {
+                const DispatchTable::Entry & entry = table.find(frame.commandId);
+                entry.invoke(entry.target, frame);
+            });
+            latency.record((uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(received - start).count());
+        });
+        report("end_to_end", "memory", N, Frame::frameSize(), operations, seconds, &latency);
+    });
+}
+
+/**
+ * A pseudo terminal whose master side drains, or echoes back, whatever
+ * is written to the slave
+ */
+class Loopback
+{
+  private:
+
+    int master = -1;
+    int slave = -1;
+    char name[256] {};
+    std::atomic_bool running { true };
+    std::thread thread;
+
+    func serve(bool echo) -> void
+    {
+        std::vector<byte_t> buffer(1 << 16);
+        struct pollfd watched { this->master, POLLIN, 0 };
+        while (this->running) {
+            if (::poll(&watched, 1, 10) <= 0) {
+                continue;
+            }
+            ssize_t received = ::read(this->master, buffer.data(), buffer.size());
+            for (ssize_t sent = 0; echo && sent < received; ) {
+                ssize_t written = ::write(this->master, buffer.data() + sent, (size_t) (received - sent));
+                if (written <= 0) {
+                    break;
+                }
+                sent += written;
+            }
+        }
+    }
+
+  public:
+
+    explicit Loopback(bool echo)
+    {
+        if (::openpty(&this->master, &this->slave, this->name, nullptr, nullptr) != 0) {
+            std::perror("openpty");
+            std::exit(1);
+        }
+        this->thread = std::thread(&Loopback::serve, this, echo);
+    }
+
+    ~Loopback()
+    {
+        this->running = false;
+        this->thread.join();
+        ::close(this->master);
+        ::close(this->slave);
+    }
+
+    func port() const -> SerialControl
+    {
+        SerialControl port;
+        if (!port.open(this->name, B115200)) {
+            std::fprintf(stderr, "unable to open %s\n", this->name);
+            std::exit(1);
+        }
+        return port;
+    }
+};
+
+static func benchmarkPublish() -> void
+{
+    if (!selected("publish", "pty")) {
+        return;
+    }
+    forEachPayload([](auto size) {
+        constexpr size_t N = decltype(size)::value;
+        Payload<N> data = makePayload<N>();
+
+        Loopback loopback(false);
+        CommHandle comm(loopback.port());
+        auto publisher = comm.advertise<COMMAND, Payload<N>>();
+
+        LatencyHistogram latency;
+        auto [operations, seconds] = measure([&] {
+            Clock::time_point start = Clock::now();
+            publisher.publish(data);
+            latency.record(nanosecondsSince(start));
+        });
+        report("publish", "pty", N, CommandFrame<Payload<N>>::frameSize(), operations, seconds, &latency);
+    });
+}
+
+/**
+ * Publish one frame, wait for its callback on the same handle, repeat.
+ * Receives either on the reader/parser ring threads or on a reactor.
+ */
+static func benchmarkPtyRoundTrip() -> void
+{
+    const bool ring = selected("end_to_end", "pty_ring");
+    const bool reactor = selected("end_to_end", "pty_reactor");
+    if (!ring && !reactor) {
+        return;
+    }
+    forEachPayload([&](auto size) {
+        constexpr size_t N = decltype(size)::value;
+        Payload<N> data = makePayload<N>();
+
+        for (int useReactor = 0; useReactor < 2; useReactor++) {
+            if (!(useReactor ? reactor : ring)) {
+                continue;
+            }
+            Loopback loopback(true);
+            CommHandle comm(loopback.port());
+            std::atomic<uint64_t> received { 0 };
+            comm.subscribe<COMMAND, Payload<N>>([&](const Payload<N> &) {
+                received.fetch_add(1, std::memory_order_release);
+            });
+
+            Reactor receiver;
+            if (useReactor) {
+                receiver.add(comm);
+                receiver.start();
+            } else {
+                comm.setReceiveRing(1 << 16);
+                comm.startReceivingAsync();
+            }
+
+            auto publisher = comm.advertise<COMMAND, Payload<N>>();
+            LatencyHistogram latency;
+            uint64_t lost = 0;
+            auto [operations, seconds] = measure([&] {
+                uint64_t expected = received.load(std::memory_order_acquire) + 1;
+                Clock::time_point start = Clock::now();
+                publisher.publish(data);
+                while (received.load(std::memory_order_acquire) < expected) {
+                    if (Clock::now() - start > 1s) {
+                        lost++;
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+                latency.record(nanosecondsSince(start));
+            });
+            report("end_to_end", useReactor ? "pty_reactor" : "pty_ring", N,
+                   CommandFrame<Payload<N>>::frameSize(), operations - lost, seconds, &latency);
+            comm.stopReceiving();
+        }
+    });
+}
+
+int main(int argc, char** argv)
+{
+    logger::setLogLevel(logger::level::LOG_ERROR);
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--quick") {
+            settings.seconds = 0.02;
+        } else if (argument == "--seconds" && i + 1 < argc) {
+            settings.seconds = std::atof(argv[++i]);
+        } else if (argument == "--help" || argument == "-h") {
+            std::printf("usage: %s [--quick] [--seconds S] [filter...]\n", argv[0]);
+            return 0;
+        } else {
+            settings.filters.push_back(argument);
+        }
+    }
+
+    benchmarkEncode();
+    benchmarkDecode();
+    benchmarkCobs();
+    benchmarkCrcs();
+    benchmarkMemoryRoundTrip();
+    benchmarkPublish();
+    benchmarkPtyRoundTrip();
+    return 0;
+}
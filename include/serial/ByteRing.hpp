@@ -0,0 +1,129 @@
+#ifndef SERIAL_BYTE_RING_HPP
+#define SERIAL_BYTE_RING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace serial
+{
+    /**
+     * Lock-free single producer, single consumer byte ring. The producer
+     * reads straight into `writable()` regions and publishes them with
+     * `commit`, the consumer parses `readable()` regions in place and
+     * frees them with `consume`. Either side parks on a condition
+     * variable only when the ring is empty or full.
+     */
+    class ByteRing
+    {
+      public:
+
+        using byte_t = unsigned char;
+        using Duration = std::chrono::milliseconds;
+
+        struct Statistics
+        {
+            size_t capacity;
+            uint64_t written;
+            uint64_t consumed;
+            size_t highWaterMark;     // most bytes ever waiting for the consumer
+            uint64_t fullStalls;      // times the producer found the ring full
+        };
+
+      private:
+
+        using Mutex = std::mutex;
+        using Lock = std::unique_lock<Mutex>;
+
+        std::unique_ptr<byte_t[]> buffer;
+        size_t capacity;
+        size_t mask;
+
+        alignas(64) std::atomic<size_t> head { 0 };  // written by the producer
+        alignas(64) std::atomic<size_t> tail { 0 };  // written by the consumer
+
+        alignas(64) std::atomic<size_t> highWaterMark { 0 };
+        std::atomic<uint64_t> fullStalls { 0 };
+
+        std::atomic_bool producerParked { false };
+        std::atomic_bool consumerParked { false };
+        std::atomic_bool closed { false };
+
+        Mutex waitMutex;
+        std::condition_variable stateChanged;
+
+        void notify(const std::atomic_bool & parked);
+
+      public:
+
+        /**
+         * @param capacity bytes, rounded up to a power of two
+         */
+        explicit ByteRing(size_t capacity);
+
+        ByteRing(const ByteRing &) = delete;
+
+        ByteRing & operator=(const ByteRing &) = delete;
+
+        /**
+         * Producer: contiguous free space starting at `region`
+         * @return its size, 0 if the ring is full
+         */
+        size_t writable(byte_t* & region);
+
+        /**
+         * Producer: publish `size` bytes written into the last `writable` region
+         */
+        void commit(size_t size);
+
+        /**
+         * Producer: wait until there is free space or the ring is closed
+         */
+        void waitWritable(Duration timeout);
+
+        /**
+         * Consumer: contiguous pending bytes starting at `region`
+         * @return their count, 0 if the ring is empty
+         */
+        size_t readable(const byte_t* & region);
+
+        /**
+         * Consumer: release the first `size` pending bytes
+         */
+        void consume(size_t size);
+
+        /**
+         * Consumer: wait until bytes are pending or the ring is closed
+         * @return false on timeout
+         */
+        bool waitReadable(Duration timeout);
+
+        /**
+         * Wake both sides, waiting returns immediately from now on
+         */
+        void close();
+
+        /**
+         * Reopen after `close`, must not race with either side
+         */
+        void reset();
+
+        [[nodiscard]]
+        inline bool isClosed() const
+        {
+            return this->closed.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]]
+        size_t size() const;
+
+        [[nodiscard]]
+        Statistics statistics() const;
+    };
+}
+
+#endif // SERIAL_BYTE_RING_HPP
@@ -0,0 +1,138 @@
+#ifndef SERIAL_CALL_TABLE_HPP
+#define SERIAL_CALL_TABLE_HPP
+
+#include "serial/TimerWheel.hpp"
+#include "serial/command/FrameDecoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace serial
+{
+    class CallTimeoutException : public std::exception
+    {
+      public:
+        [[nodiscard]]
+        const char* what() const noexcept override
+        {
+            return "no response within the timeout";
+        }
+    };
+
+    class CallNotSentException : public std::exception
+    {
+      public:
+        [[nodiscard]]
+        const char* what() const noexcept override
+        {
+            return "request could not be sent";
+        }
+    };
+
+    /**
+     * Outstanding remote calls. A request's DATA starts with a little
+     * endian 16 bit call id that the peer copies in front of its
+     * response, so any number of calls can wait on the link at once and
+     * responses may come in any order. Timeouts run on a timer wheel.
+     */
+    class CallTable
+    {
+      public:
+
+        using byte_t = unsigned char;
+        using Duration = std::chrono::microseconds;
+
+        static constexpr size_t ID_SIZE = 2;
+
+        enum class Outcome : uint8_t
+        {
+            RESPONSE,
+            TIMEOUT,
+            NOT_SENT,
+        };
+
+        /**
+         * Called exactly once per call, with the response DATA after the
+         * call id for `RESPONSE` and null otherwise
+         */
+        using Completion = std::function<void(Outcome outcome, const byte_t* response)>;
+
+        struct Statistics
+        {
+            uint64_t calls;
+            uint64_t responses;
+            uint64_t timeouts;
+            uint64_t notSent;
+            uint64_t unmatched;       // responses to no outstanding call, late ones included
+            size_t outstanding;
+            size_t maxOutstanding;
+        };
+
+        static inline void writeId(byte_t* output, uint16_t id)
+        {
+            output[0] = (byte_t) (id & 0xFF);
+            output[1] = (byte_t) (id >> 8);
+        }
+
+        static inline uint16_t readId(const byte_t* data)
+        {
+            return (uint16_t) (data[0] | data[1] << 8);
+        }
+
+      private:
+
+        using Mutex = std::mutex;
+        using Lock = std::unique_lock<Mutex>;
+
+        struct Call
+        {
+            uint16_t responseCommand;
+            uint64_t timer;           // wheel id, the call id and a count telling reused ids apart
+            Completion completion;
+        };
+
+        Mutex mutex;
+        std::unordered_map<uint16_t, Call> calls;
+        uint16_t nextId = 0;
+        uint64_t nextTimer = 0;
+        Statistics statistics {};
+        TimerWheel wheel;
+
+        void expire(uint64_t timer);
+
+      public:
+
+        explicit CallTable(const TimerWheel::Options & options = TimerWheel::Options());
+
+        CallTable(const CallTable &) = delete;
+
+        CallTable & operator=(const CallTable &) = delete;
+
+        /**
+         * Register a call waiting for a `responseCommand` frame
+         * @param id set to the call id to send with the request
+         * @return false if every call id is taken, the call is completed as `NOT_SENT`
+         */
+        bool open(uint16_t responseCommand, Duration timeout, Completion completion, uint16_t & id);
+
+        /**
+         * Complete a call whose request could not be sent
+         */
+        void abandon(uint16_t id);
+
+        /**
+         * Complete the call a response frame belongs to, DLEN was checked
+         * to hold the call id
+         */
+        void respond(const command::FrameView & frame);
+
+        [[nodiscard]]
+        Statistics getStatistics();
+    };
+}
+
+#endif // SERIAL_CALL_TABLE_HPP
@@ -0,0 +1,135 @@
+#ifndef SERIAL_CALLBACK_EXECUTOR_HPP
+#define SERIAL_CALLBACK_EXECUTOR_HPP
+
+#include "serial/LinkStatistics.hpp"
+#include "serial/SendQueue.hpp"
+#include "serial/command/DispatchTable.hpp"
+#include "serial/command/FramePool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace serial
+{
+    /**
+     * Runs subscriber callbacks on a pool of worker threads. A command id
+     * always maps to the same worker, so callbacks of one command run in
+     * arrival order while different commands run in parallel. Every worker
+     * has a bounded queue, what happens when it is full is decided by the
+     * overflow policy.
+     */
+    class CallbackExecutor
+    {
+      public:
+
+        struct Options
+        {
+            size_t threads = 2;
+            size_t queueCapacity = 1024;                  // callbacks per worker
+            OverflowPolicy overflow = OverflowPolicy::BLOCK;
+        };
+
+        struct CommandStatistics
+        {
+            uint64_t executed;
+            uint64_t droppedOldest;
+            uint64_t droppedNewest;
+            size_t backlog;      // queued or running
+            size_t maxBacklog;
+        };
+
+      private:
+
+        using Mutex = std::mutex;
+        using Lock = std::unique_lock<Mutex>;
+
+        struct Task
+        {
+            command::DispatchTable::Entry entry;
+            command::FrameBuffer buffer;
+            LinkStatistics::Clock::time_point decoded;
+        };
+
+        struct Worker
+        {
+            Mutex mutex;
+            std::condition_variable ready;
+            std::condition_variable space;
+            std::condition_variable idle;
+
+            std::vector<Task> ring;
+            size_t head = 0;
+            size_t count = 0;
+            bool busy = false;
+
+            std::unordered_map<uint16_t, CommandStatistics> commands;
+            std::thread thread;
+        };
+
+        Options options;
+        LinkStatistics* linkStatistics;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic_bool running { true };
+
+        void workerDaemon(Worker & worker);
+
+      public:
+
+        CallbackExecutor();
+
+        /**
+         * @param linkStatistics if set, callback latency and duration are recorded there
+         */
+        explicit CallbackExecutor(const Options & options, LinkStatistics* linkStatistics = nullptr);
+
+        CallbackExecutor(const CallbackExecutor &) = delete;
+
+        CallbackExecutor & operator=(const CallbackExecutor &) = delete;
+
+        /**
+         * Runs every queued callback, then stops the workers
+         */
+        ~CallbackExecutor();
+
+        /**
+         * Queue `entry.invoke` for the frame, the payload is kept alive by
+         * its pooled buffer until the callback returns
+         * @param decoded when the frame was decoded, for the latency histogram
+         * @return false if the frame was dropped
+         */
+        bool submit(const command::DispatchTable::Entry & entry, const command::FrameBuffer & buffer,
+                    LinkStatistics::Clock::time_point decoded = {});
+
+        /**
+         * Block until every callback submitted so far has returned
+         */
+        void drain();
+
+        /**
+         * @return true on a worker thread of any executor
+         */
+        [[nodiscard]]
+        static bool onWorkerThread();
+
+        /**
+         * @return counters of one command, all zero if it was never submitted
+         */
+        [[nodiscard]]
+        CommandStatistics statistics(uint16_t commandId);
+
+        /**
+         * @return counters of every command submitted so far
+         */
+        [[nodiscard]]
+        std::unordered_map<uint16_t, CommandStatistics> statistics();
+    };
+}
+
+#endif // SERIAL_CALLBACK_EXECUTOR_HPP
@@ -0,0 +1,218 @@
+#ifndef SERIAL_CAPTURE_HPP
+#define SERIAL_CAPTURE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace serial
+{
+    using String = std::string;
+
+    /**
+     * Capture file layout, host byte order (little endian on every
+     * supported target). A file is a `CaptureFileHeader` followed by
+     * records. Each record is a `CaptureRecordHeader` and its bytes,
+     * padded to 8 bytes, so a mapped file can be walked in place.
+     * Records are only ever appended, a record cut short by a crash is
+     * ignored when reading.
+     */
+    struct CaptureFileHeader
+    {
+        static constexpr char MAGIC[8] = { 'S', 'E', 'R', 'C', 'A', 'P', '\r', '\n' };
+        static constexpr uint32_t VERSION = 1;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;      // offset of the first record
+        int64_t wallClockStart;   // system clock at the start, ns since the epoch
+        int64_t reserved;
+    };
+
+    enum class CaptureDirection : uint8_t
+    {
+        RECEIVED = 0,
+        SENT = 1,
+    };
+
+    struct CaptureRecordHeader
+    {
+        static constexpr size_t ALIGNMENT = 8;
+
+        uint64_t time;            // steady clock, ns since the capture started
+        uint32_t length;          // bytes following the header, padding excluded
+        CaptureDirection direction;
+        uint8_t reserved[3];
+    };
+
+    static_assert(sizeof(CaptureFileHeader) == 32, "capture header layout");
+    static_assert(sizeof(CaptureRecordHeader) == 16, "capture record layout");
+
+    /**
+     * Appends the chunks read from and written to a port to a capture
+     * file. Records are collected in memory and written in blocks of
+     * `bufferSize`, every thread of a CommHandle may record at once.
+     */
+    class CaptureWriter
+    {
+      private:
+
+        using Clock = std::chrono::steady_clock;
+        using Mutex = std::mutex;
+
+        Mutex mutex;
+        int fd = -1;
+        Clock::time_point start;
+        std::vector<unsigned char> buffer;
+        size_t bufferSize;
+        uint64_t records = 0;
+
+        void append(const void* data, size_t size);
+
+        void writeBuffer();
+
+      public:
+
+        explicit CaptureWriter(size_t bufferSize = 64 * 1024);
+
+        CaptureWriter(const CaptureWriter &) = delete;
+
+        CaptureWriter & operator=(const CaptureWriter &) = delete;
+
+        ~CaptureWriter();
+
+        /**
+         * Start a new capture file, closing the previous one
+         * @return false if the file cannot be created
+         */
+        bool open(const String & path);
+
+        /**
+         * Write what is buffered and close the file, later records are ignored
+         */
+        void close();
+
+        [[nodiscard]]
+        bool isOpen();
+
+        void record(CaptureDirection direction, const void* data, size_t size);
+
+        /**
+         * Record the first `size` bytes of a scatter/gather write
+         */
+        void record(CaptureDirection direction, const struct iovec* buffers, int count, size_t size);
+
+        /**
+         * Write buffered records to the file
+         */
+        void flush();
+
+        /**
+         * @return records captured into the current file
+         */
+        [[nodiscard]]
+        uint64_t size();
+    };
+
+    /**
+     * A record of a mapped capture file, only valid while the reader is
+     */
+    struct CaptureChunk
+    {
+        uint64_t time;
+        CaptureDirection direction;
+        const unsigned char* data;
+        size_t length;
+    };
+
+    /**
+     * Maps a capture file and walks its records without copying
+     *
+     *     CaptureReader reader(path);
+     *     CaptureChunk chunk;
+     *     while (reader.next(chunk)) {
+     *         ...
+     *     }
+     */
+    class CaptureReader
+    {
+      private:
+
+        const unsigned char* mapping = nullptr;
+        size_t mappingSize = 0;
+        size_t position = 0;
+        size_t firstRecord = 0;
+        int64_t wallClockStart = 0;
+
+      public:
+
+        CaptureReader() = default;
+
+        explicit CaptureReader(const String & path);
+
+        CaptureReader(const CaptureReader &) = delete;
+
+        CaptureReader & operator=(const CaptureReader &) = delete;
+
+        ~CaptureReader();
+
+        /**
+         * Map a capture file
+         * @return false if it cannot be read or is not a capture
+         */
+        bool open(const String & path);
+
+        void close();
+
+        [[nodiscard]]
+        inline bool isOpen() const
+        {
+            return this->mapping != nullptr;
+        }
+
+        /**
+         * @return false at the end of the file or at a truncated record
+         */
+        bool next(CaptureChunk & chunk);
+
+        /**
+         * Go back to the first record
+         */
+        inline void rewind()
+        {
+            this->position = this->firstRecord;
+        }
+
+        /**
+         * @return system clock time the capture started, ns since the epoch
+         */
+        [[nodiscard]]
+        inline int64_t startTime() const
+        {
+            return this->wallClockStart;
+        }
+    };
+
+    struct ReplayOptions
+    {
+        bool originalTiming = false;   // sleep between chunks as recorded, otherwise as fast as possible
+        double speed = 1.0;            // with original timing, 2.0 replays twice as fast
+        CaptureDirection direction = CaptureDirection::RECEIVED;
+    };
+
+    struct ReplayResult
+    {
+        uint64_t chunks;
+        uint64_t bytes;
+        uint64_t frames;               // decoded, whether or not anyone subscribed
+        double seconds;
+        double framesPerSecond;
+    };
+}
+
+#endif // SERIAL_CAPTURE_HPP
@@ -2,12 +2,36 @@
 #ifndef SERIAL_COMM_HANDLE_HPP
 #define SERIAL_COMM_HANDLE_HPP
 
+#include "serial/ByteRing.hpp"
+#include "serial/CallTable.hpp"
+#include "serial/CallbackExecutor.hpp"
+#include "serial/Capture.hpp"
+#include "serial/FrameAggregator.hpp"
+#include "serial/FrameWaiters.hpp"
+#include "serial/LinkStatistics.hpp"
+#include "serial/PrioritySender.hpp"
+#include "serial/ReceiveOptions.hpp"
+#include "serial/ReliableChannel.hpp"
+#include "serial/SendQueue.hpp"
 #include "serial/SerialControl.hpp"
+#include "serial/WriteCoalescer.hpp"
 #include "serial/command/CommandFrame.hpp"
+#include "serial/command/DeltaCodec.hpp"
+#include "serial/command/DispatchTable.hpp"
+#include "serial/command/Fragment.hpp"
+#include "serial/command/FrameDecoder.hpp"
+#include "serial/command/Superframe.hpp"
+#include "serial/command/Span.hpp"
 #include "serial/utils/Logger.hpp"
 
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <future>
 #include <thread>
 #include <mutex>
+#include <memory>
+#include <type_traits>
 #include <unordered_map>
 
 namespace serial
@@ -16,6 +40,8 @@ namespace serial
 
     using namespace command;
 
+    class Reactor;
+
     class CommHandle
     {
       private:
@@ -35,6 +61,7 @@ namespace serial
 
         SerialControl serialPort {};
         byte_t sof = 0xA5;
+        Framing framing = Framing::SOF;
 
         int baudRate;
         String serialDevice;
@@ -46,27 +73,213 @@ namespace serial
 
         struct SubscriberBase
         {
-            virtual uint16_t cmd() = 0;
-            virtual void receive(uint8_t* data) = 0;
+            virtual ~SubscriberBase() = default;
         };
 
-        using SubscriberPtr = Ref<SubscriberBase>;
+        using SubscriberPtr = std::unique_ptr<SubscriberBase>;
+
+        // owns the subscribers, frames are dispatched through `dispatchTable`
         HashMap<uint16_t, SubscriberPtr> subscribers;
+        DispatchTable dispatchTable;
+
+        struct DeltaChannel
+        {
+            Mutex mutex;             // held while a frame is encoded and written, so they leave in order
+            DeltaEncoder encoder;
+            DeltaDecoder decoder;    // receiving thread only
+            std::atomic<uint64_t> keyframesSent { 0 };
+            std::atomic<uint64_t> deltasSent { 0 };
+            std::atomic<uint64_t> bytesSaved { 0 };
+            std::atomic<uint64_t> keyframesReceived { 0 };
+            std::atomic<uint64_t> deltasReceived { 0 };
+            std::atomic<uint64_t> dropped { 0 };
+
+            DeltaChannel(size_t size, const DeltaOptions & options) : encoder(size, options), decoder(size) {}
+        };
+
+        // commands in delta mode, set up before publishing and receiving
+        HashMap<uint16_t, std::unique_ptr<DeltaChannel>> deltaChannels;
+
+        // commands coroutines wait for with `next`, set up before receiving
+        HashMap<uint16_t, std::unique_ptr<FrameWaiters>> frameWaiters;
+
+        struct Reassembly
+        {
+            FrameBuffer buffer;
+            size_t received = 0;     // bytes, in order from offset 0
+        };
+
+        // payloads arriving in fragments, receiving thread only
+        HashMap<uint16_t, Reassembly> reassemblies;
+
+        using RouteDispatch = RouteResult (*)(const FrameView &);
+        RouteDispatch routes = nullptr;
 
         Mutex sendMutex;
         Mutex recvMutex;
         Thread receivingDaemonThread;
 
+        std::unique_ptr<FramePool> framePool = std::make_unique<FramePool>();
+        FrameDecoder decoder { 0xA5, UINT16_MAX, framePool.get() };
+        uint8_t lastSequence = -1;
+
+        LinkStatistics linkStatistics;
+        LinkStatistics::Clock::time_point decodedAt;  // of the span being dispatched
+
+        Reactor* reactor = nullptr;
+        std::atomic<uint32_t> connections { 0 };
+
+        friend class Reactor;
+
+        std::unique_ptr<FrameAggregator> aggregator;
+        std::unique_ptr<ReliableChannel> reliable;
+        std::unique_ptr<PrioritySender> prioritySender;
+        std::atomic<uint8_t> sequence { 0 };
+        Mutex fragmentMutex;     // pieces of one payload get consecutive numbers in reliable mode
+        std::unique_ptr<CallTable> callTable;
+        std::unique_ptr<WriteCoalescer> coalescer;
+        std::unique_ptr<SendQueue> sendQueue;
+        std::unique_ptr<CallbackExecutor> executor;
+        std::unique_ptr<ByteRing> receiveRing;
+        AtomicBool pipelineActive { false };
+        AtomicBool readerActive { false };   // the single receiving thread, until its last read returns
+
+        ReceiveOptions receiveOptions;
+
+        std::unique_ptr<CaptureWriter> captureWriter;
+
         Function<void()> receivingDaemon();
 
+        /**
+         * Read whatever the port has, reconnecting or throwing on a closed
+         * port. Under a reactor it always throws, the reactor reconnects.
+         * @return number of bytes read, -1 if nothing was read
+         */
+        func readPort(byte_t* buffer, size_t size) -> int;
+
+        /**
+         * Read whatever the port has and run it through the parser
+         * @return number of bytes read, -1 if nothing was read
+         */
+        func receiveAvailable(byte_t* buffer, size_t size) -> int;
+
+        /**
+         * Reader stage of the receive ring, only drains the port
+         */
+        func readingDaemon() -> void;
+
+        /**
+         * Parser stage of the receive ring, decodes and dispatches
+         */
+        func parsingDaemon() -> void;
+
+        func processBytes(const byte_t* buffer, size_t received) -> void;
+
+        func dispatch(const FrameView & frame) -> void;
+
+        func deliver(const FrameView & frame, LinkStatistics::Command & statistics) -> void;
+
+        inline func findDelta(uint16_t commandId) -> DeltaChannel*
+        {
+            if (this->deltaChannels.empty()) {
+                return nullptr;
+            }
+            auto found = this->deltaChannels.find(commandId);
+            return found == this->deltaChannels.end() ? nullptr : found->second.get();
+        }
+
+        func publishDelta(DeltaChannel & channel, uint16_t commandId, const void* data, Priority priority) -> bool;
+
+        /**
+         * Publish a payload through the aggregator, or as a frame of its own
+         */
+        func sendPayload(uint16_t commandId, const void* data, size_t length, Priority priority) -> bool;
+
+        /**
+         * Publish a payload as a frame of its own, or as fragments if it
+         * would hold a lower priority lane for longer than a time slice
+         */
+        func framePayload(uint16_t commandId, const void* data, size_t length, Priority priority) -> bool;
+
+        /**
+         * Publish a payload as exactly one frame, numbered by the reliable
+         * channel when there is one
+         */
+        func sendDynamic(uint16_t commandId, const void* data, size_t length, Priority priority) -> bool;
+
+        inline func nextSequence() -> uint8_t
+        {
+            return this->sequence.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * Dispatch target of response commands, `target` is the call table
+         */
+        static func receiveResponse(void* target, const FrameView & frame) -> void;
+
+        /**
+         * Dispatch every record of a superframe as a frame of its own
+         */
+        func unpack(const FrameView & frame, LinkStatistics::Command & statistics) -> void;
+
+        /**
+         * Collect a fragment and dispatch its payload once it is whole
+         */
+        func reassemble(const FrameView & frame, LinkStatistics::Command & statistics) -> void;
+
+        /**
+         * COBS encode a frame given as `count` buffers and append the delimiter
+         * @return the encoded bytes, valid until the next call on this thread
+         */
+        static func encodeCobs(const struct iovec* buffers, int count, size_t size) -> Span<byte_t>;
+
+        /**
+         * Put a frame given as `count` buffers into `output` in the handle's framing
+         */
+        func encodeFrame(const struct iovec* buffers, int count, size_t size, std::vector<byte_t> & output) -> void;
+
+        /**
+         * Write a frame given as `count` buffers in the handle's framing,
+         * through the priority lanes, the send queue, the coalescer or directly
+         */
+        func sendFrame(const struct iovec* buffers, int count, size_t size, Priority priority = Priority::NORMAL) -> bool;
+
+        /**
+         * Like `sendFrame` for a frame already in the handle's framing
+         */
+        func sendEncoded(const struct iovec* buffers, int count, size_t size, Priority priority) -> bool;
+
+        template <typename SendFunction>
+        func sendGuarded(SendFunction && send) -> int
+        {
+            try {
+                return send(this->serialPort);
+            } catch (serial::SerialClosedException & exception) {
+                logger::error("Serial device connection closed");
+                if (this->doReconnect) {
+                    this->reconnect();
+                } else {
+                    throw serial::SerialClosedException();
+                }
+            }
+            return 0;
+        }
+
+        func writeDirect(const struct iovec* buffers, int count) -> int;
+
+        func writeBuffers(const struct iovec* buffers, int count) -> int;
+
       public:
 
+        class PublishBatch;
+
         template <uint16_t Cmd, typename CmdData>
         class Publisher
         {
           private:
 
             CommHandle* handle;
+            Priority priority = Priority::NORMAL;
 
             func cmd() -> uint16_t
             {
@@ -74,38 +287,256 @@ namespace serial
             }
 
             friend class CommHandle;
+            friend class PublishBatch;
 
           public:
 
             Publisher() = default;
 
-            Publisher(const Publisher & another) : handle(another.handle) {}
+            Publisher(const Publisher & another) : handle(another.handle), priority(another.priority) {}
 
-            explicit Publisher(CommHandle* handle) : handle(handle) {}
+            explicit Publisher(CommHandle* handle, Priority priority = Priority::NORMAL) : handle(handle), priority(priority) {}
 
             func publish(const CmdData & data) -> bool
             {
-                CommandFrame<CmdData> commandFrame = CommandFrame<CmdData>(this->cmd(), data, handle->sof);
-                handle->sendMutex.lock();
-                int sent = 0;
-                try {
-                    sent = handle->serialPort.send(commandFrame.toBytes());
-                } catch (serial::SerialClosedException & exception) {
-                    logger::error("Serial device connection closed");
-                    if (handle->doReconnect) {
-                        this->handle->reconnect();
+                if (DeltaChannel* channel = handle->findDelta(Cmd)) {
+                    return handle->publishDelta(*channel, Cmd, &data, this->priority);
+                }
+                if (handle->aggregator || handle->prioritySender || handle->reliable) {
+                    return handle->sendPayload(Cmd, &data, sizeof(CmdData), this->priority);
+                }
+                CommandFrame<CmdData> commandFrame(this->cmd(), data, handle->sof, handle->nextSequence());
+                struct iovec buffer { (void*) &commandFrame.getRawFrame(), commandFrame.frameSize() };
+                return handle->sendFrame(&buffer, 1, commandFrame.frameSize());
+            }
+
+            /**
+             * `co_await` to publish once the reliable window has room,
+             * without blocking a thread, see serial/Coroutine.hpp
+             * @return awaits the result of `publish`
+             */
+            auto publishAsync(const CmdData & data);
+        };
+
+        /**
+         * Publishes a variable number of `CmdData` elements per frame,
+         * DLEN carries only the bytes actually sent
+         */
+        template <uint16_t Cmd, typename CmdData>
+        class SpanPublisher
+        {
+          private:
+
+            CommHandle* handle;
+            Priority priority = Priority::NORMAL;
+
+            friend class CommHandle;
+
+          public:
+
+            static constexpr size_t MAX_ELEMENTS = DynamicCommandFrame::MAX_DATA_SIZE / sizeof(CmdData);
+
+            SpanPublisher() = default;
+
+            explicit SpanPublisher(CommHandle* handle, Priority priority = Priority::NORMAL) : handle(handle), priority(priority) {}
+
+            /**
+             * @return false if more than `MAX_ELEMENTS` are given or the frame was not sent whole
+             */
+            func publish(Span<CmdData> elements) -> bool
+            {
+                if (elements.size() > MAX_ELEMENTS) {
+                    logger::error("Too many elements for command id ", Cmd, ": ", elements.size(), " > ", MAX_ELEMENTS);
+                    return false;
+                }
+                return handle->sendPayload(Cmd, elements.data(), elements.sizeBytes(), this->priority);
+            }
+
+            func publish(const CmdData* elements, size_t count) -> bool
+            {
+                return this->publish(Span<CmdData>(elements, count));
+            }
+        };
+
+        /**
+         * Sends `Req` as `ReqCmd` and completes a future with the `Resp`
+         * the peer answers as `RespCmd`
+         */
+        template <uint16_t ReqCmd, typename Req, uint16_t RespCmd, typename Resp>
+        class Caller
+        {
+          private:
+
+            CommHandle* handle;
+            Priority priority = Priority::NORMAL;
+
+            friend class CommHandle;
+
+          public:
+
+            Caller() = default;
+
+            explicit Caller(CommHandle* handle, Priority priority = Priority::NORMAL) : handle(handle), priority(priority) {}
+
+            /**
+             * Send a request without waiting, any number may be outstanding
+             * @return the response, or `CallTimeoutException` once `timeout`
+             *     passed and `CallNotSentException` if the request was dropped
+             */
+            func call(const Req & request, std::chrono::microseconds timeout) -> std::future<Resp>
+            {
+                auto promise = std::make_shared<std::promise<Resp>>();
+                std::future<Resp> future = promise->get_future();
+                this->call(request, timeout, [promise](CallTable::Outcome outcome, const byte_t* data) {
+                    if (outcome == CallTable::Outcome::RESPONSE) {
+                        Resp response;
+                        std::memcpy(&response, data, sizeof(Resp));
+                        promise->set_value(response);
+                    } else if (outcome == CallTable::Outcome::TIMEOUT) {
+                        promise->set_exception(std::make_exception_ptr(CallTimeoutException()));
                     } else {
-                        throw serial::SerialClosedException();
+                        promise->set_exception(std::make_exception_ptr(CallNotSentException()));
                     }
+                });
+                return future;
+            }
+
+            /**
+             * Like `call`, `completion` runs once on the receiving thread
+             * with the response, or on the timer wheel's thread
+             */
+            func call(const Req & request, std::chrono::microseconds timeout, CallTable::Completion completion) -> void
+            {
+                uint16_t id;
+                if (!handle->callTable->open(RespCmd, timeout, std::move(completion), id)) {
+                    return;
+                }
+                byte_t payload[CallTable::ID_SIZE + sizeof(Req)];
+                CallTable::writeId(payload, id);
+                std::memcpy(payload + CallTable::ID_SIZE, &request, sizeof(Req));
+                if (!handle->sendPayload(ReqCmd, payload, sizeof(payload), this->priority)) {
+                    handle->callTable->abandon(id);
+                }
+            }
+
+            /**
+             * `co_await` for the response of a `call`, see serial/Coroutine.hpp
+             * @return awaits the response, or throws like the future of `call`
+             */
+            auto callAsync(const Req & request, std::chrono::microseconds timeout);
+        };
+
+        /**
+         * Collects frames from any number of publishers in an inline
+         * buffer and writes them with a single syscall on `flush()`
+         */
+        class PublishBatch
+        {
+          private:
+
+            CommHandle* handle;
+            std::array<byte_t, 4096> buffer {};
+            size_t used = 0;
+            size_t frameCount = 0;
+
+            func append(const void* frame, size_t frameSize) -> bool
+            {
+                if (used + frameSize > buffer.size()) {
+                    // does not fit, the batch so far and this frame leave together
+                    struct iovec buffers[2] = {
+                        { buffer.data(), used },
+                        { const_cast<void*>(frame), frameSize }
+                    };
+                    size_t total = used + frameSize;
+                    used = 0;
+                    frameCount = 0;
+                    return handle->writeBuffers(buffers, 2) == (int) total;
+                }
+                std::memcpy(buffer.data() + used, frame, frameSize);
+                used += frameSize;
+                frameCount++;
+                return true;
+            }
+
+          public:
+
+            explicit PublishBatch(CommHandle* handle) : handle(handle) {}
+
+            PublishBatch(const PublishBatch &) = delete;
+
+            PublishBatch & operator=(const PublishBatch &) = delete;
+
+            /**
+             * Flushes, frames that cannot be written any more are dropped and logged
+             */
+            ~PublishBatch()
+            {
+                try {
+                    this->flush();
+                } catch (std::exception & exception) {
+                    static logger::RateLimiter limiter;
+                    logger::warning(limiter, "Batched frames dropped at teardown: ", exception.what());
+                }
+            }
+
+            /**
+             * In reliable mode the frame is sent at once, every frame must be kept until acknowledged.
+             * A command in delta mode is encoded like a publish and written at once, after the
+             * frames batched so far, so its deltas leave in the order they were encoded.
+             */
+            template <uint16_t Cmd, typename CmdData>
+            func add(const Publisher<Cmd, CmdData> & publisher, const CmdData & data) -> bool
+            {
+                if (DeltaChannel* channel = handle->findDelta(Cmd)) {
+                    bool flushed = this->flush();
+                    return handle->publishDelta(*channel, Cmd, &data, publisher.priority) && flushed;
+                }
+                if (handle->reliable) {
+                    return handle->sendPayload(Cmd, &data, sizeof(CmdData), publisher.priority);
+                }
+                CommandFrame<CmdData> commandFrame(Cmd, data, handle->sof, handle->nextSequence());
+                if (handle->framing == Framing::COBS) {
+                    struct iovec frame { (void*) &commandFrame.getRawFrame(), commandFrame.frameSize() };
+                    Span<byte_t> encoded = CommHandle::encodeCobs(&frame, 1, commandFrame.frameSize());
+                    return this->append(encoded.data(), encoded.size());
+                }
+                return this->append(&commandFrame.getRawFrame(), commandFrame.frameSize());
+            }
+
+            func flush() -> bool
+            {
+                if (used == 0) {
+                    return true;
                 }
-                handle->sendMutex.unlock();
-                return sent == sizeof(CmdData);
+                struct iovec buffers[1] = { { buffer.data(), used } };
+                size_t total = used;
+                used = 0;
+                frameCount = 0;
+                return handle->writeBuffers(buffers, 1) == (int) total;
+            }
+
+            [[nodiscard]]
+            func size() const -> size_t
+            {
+                return used;
+            }
+
+            [[nodiscard]]
+            func frames() const -> size_t
+            {
+                return frameCount;
             }
         };
 
         template <typename CmdData>
         using Callback = Function<void(const CmdData &)>;
 
+        template <typename CmdData>
+        using SharedCallback = Function<void(const FrameRef<CmdData> &)>;
+
+        template <typename CmdData>
+        using SpanCallback = Function<void(Span<CmdData>)>;
+
       private:
 
         template <uint16_t Cmd, typename CmdData>
@@ -115,19 +546,79 @@ namespace serial
 
             Callback<CmdData> callback;
 
-            func receive(uint8_t* data) -> void override
+          public:
+
+            explicit Subscriber(Callback<CmdData> callback) : callback(std::move(callback)) {}
+
+            static func receive(void* target, const FrameView & frame) -> void
             {
-                auto* cmdData = reinterpret_cast<CmdData*>(data);
-                this->callback(*cmdData);
+                auto* cmdData = reinterpret_cast<const CmdData*>(frame.data);
+                static_cast<Subscriber*>(target)->callback(*cmdData);
             }
+        };
+
+        template <uint16_t Cmd, typename CmdData>
+        class SharedSubscriber : public SubscriberBase
+        {
+          private:
+
+            SharedCallback<CmdData> callback;
 
           public:
 
-            explicit Subscriber(Callback<CmdData> callback) : callback(callback) {}
+            explicit SharedSubscriber(SharedCallback<CmdData> callback) : callback(std::move(callback)) {}
 
-            func cmd() -> uint16_t override
+            static func receive(void* target, const FrameView & frame) -> void
             {
-                return Cmd;
+                static_cast<SharedSubscriber*>(target)->callback(FrameRef<CmdData>(*frame.buffer));
+            }
+        };
+
+        template <uint16_t ReqCmd, typename Req, uint16_t RespCmd, typename Resp>
+        class Server : public SubscriberBase
+        {
+          private:
+
+            CommHandle* handle;
+            Function<Resp(const Req &)> handler;
+            Priority priority;
+
+          public:
+
+            Server(CommHandle* handle, Function<Resp(const Req &)> handler, Priority priority)
+                : handle(handle), handler(std::move(handler)), priority(priority) {}
+
+            // the length was checked against the entry before dispatching
+            static func receive(void* target, const FrameView & frame) -> void
+            {
+                auto* server = static_cast<Server*>(target);
+                Req request;
+                std::memcpy(&request, frame.data + CallTable::ID_SIZE, sizeof(Req));
+                Resp response = server->handler(request);
+
+                byte_t payload[CallTable::ID_SIZE + sizeof(Resp)];
+                std::memcpy(payload, frame.data, CallTable::ID_SIZE);
+                std::memcpy(payload + CallTable::ID_SIZE, &response, sizeof(Resp));
+                server->handle->sendPayload(RespCmd, payload, sizeof(payload), server->priority);
+            }
+        };
+
+        template <uint16_t Cmd, typename CmdData>
+        class SpanSubscriber : public SubscriberBase
+        {
+          private:
+
+            SpanCallback<CmdData> callback;
+
+          public:
+
+            explicit SpanSubscriber(SpanCallback<CmdData> callback) : callback(std::move(callback)) {}
+
+            // the length was checked against the entry before dispatching
+            static func receive(void* target, const FrameView & frame) -> void
+            {
+                auto* elements = reinterpret_cast<const CmdData*>(frame.data);
+                static_cast<SpanSubscriber*>(target)->callback(Span<CmdData>(elements, frame.dataLength / sizeof(CmdData)));
             }
         };
 
@@ -135,6 +626,17 @@ namespace serial
 
         void reconnect();
 
+        /**
+         * One attempt to reopen a closed port, without waiting
+         * @return true if the port is open, also when another thread reopened it
+         */
+        bool tryReconnect();
+
+        /**
+         * Apply the port related part of `receiveOptions` to the open port
+         */
+        void applyPortOptions();
+
       public:
 
         explicit CommHandle(const SerialControl & serialPortControl, byte_t sof = 0xA5);
@@ -149,27 +651,373 @@ namespace serial
 
         void autoConnect(int baud = B115200);
 
+        /**
+         * @param priority lane of the command's frames once priority lanes are enabled
+         */
         template <uint16_t Cmd, typename CmdData>
-        Publisher<Cmd, CmdData> advertise()
+        Publisher<Cmd, CmdData> advertise(Priority priority = Priority::NORMAL)
+        {
+            return CommHandle::Publisher<Cmd, CmdData>(this, priority);
+        }
+
+        /**
+         * Publisher of frames holding any number of `CmdData` elements
+         */
+        template <uint16_t Cmd, typename CmdData = byte_t>
+        SpanPublisher<Cmd, CmdData> advertiseSpan(Priority priority = Priority::NORMAL)
+        {
+            return CommHandle::SpanPublisher<Cmd, CmdData>(this, priority);
+        }
+
+        /**
+         * Caller of a remote procedure taking a `Req` as `ReqCmd` and
+         * answering a `Resp` as `RespCmd`. Call before receiving starts,
+         * `RespCmd` frames then only complete calls. Futures still
+         * outstanding when the handle is destroyed fail with `std::future_error`.
+         */
+        template <uint16_t ReqCmd, typename Req, uint16_t RespCmd, typename Resp>
+        Caller<ReqCmd, Req, RespCmd, Resp> advertiseCall(Priority priority = Priority::NORMAL)
+        {
+            static_assert(std::is_trivially_copyable_v<Req> && std::is_trivially_copyable_v<Resp>, "sent as raw bytes");
+            static_assert(CallTable::ID_SIZE + sizeof(Req) <= DynamicCommandFrame::MAX_DATA_SIZE, "request does not fit a frame");
+            static_assert(CallTable::ID_SIZE + sizeof(Resp) <= DynamicCommandFrame::MAX_DATA_SIZE, "response does not fit a frame");
+            if (!this->callTable) {
+                this->callTable = std::make_unique<CallTable>();
+            }
+            auto length = (uint16_t) (CallTable::ID_SIZE + sizeof(Resp));
+            this->subscribers.erase(RespCmd);
+            this->dispatchTable.set(RespCmd, &CommHandle::receiveResponse, this->callTable.get(), length, length);
+            return CommHandle::Caller<ReqCmd, Req, RespCmd, Resp>(this, priority);
+        }
+
+        /**
+         * Answer `ReqCmd` requests of a peer's `Caller` with the result of
+         * `handler`, called like a subscriber. Call before receiving starts.
+         */
+        template <uint16_t ReqCmd, typename Req, uint16_t RespCmd, typename Resp>
+        func serve(Function<Resp(const Req &)> handler, Priority priority = Priority::NORMAL) -> void
+        {
+            static_assert(std::is_trivially_copyable_v<Req> && std::is_trivially_copyable_v<Resp>, "sent as raw bytes");
+            static_assert(CallTable::ID_SIZE + sizeof(Resp) <= DynamicCommandFrame::MAX_DATA_SIZE, "response does not fit a frame");
+            auto server = std::make_unique<Server<ReqCmd, Req, RespCmd, Resp>>(this, std::move(handler), priority);
+            auto length = (uint16_t) (CallTable::ID_SIZE + sizeof(Req));
+            dispatchTable.set(ReqCmd, &Server<ReqCmd, Req, RespCmd, Resp>::receive, server.get(), length, length);
+            subscribers[ReqCmd] = std::move(server);
+        }
+
+        /**
+         * @return all zero before the first `advertiseCall`
+         */
+        [[nodiscard]]
+        CallTable::Statistics callStatistics() const;
+
+        /**
+         * Start a batch, frames added to it are written together on flush
+         */
+        func batch() -> PublishBatch
         {
-            return CommHandle::Publisher<Cmd, CmdData>(this);
+            return PublishBatch(this);
         }
 
+        /**
+         * Coalesce published frames, flushing once `maxBytes` are pending
+         * or `maxDelay` after the first pending frame. Must be set before
+         * publishing from other threads.
+         */
+        void enableCoalescing(size_t maxBytes = 1024, std::chrono::microseconds maxDelay = std::chrono::microseconds(500));
+
+        void disableCoalescing();
+
+        /**
+         * Pack the payloads of publishes that meet within `maxDelay`, up
+         * to `maxBytes`, as records of one superframe with one header and
+         * one CRC16. Any receiver unpacks them into the ordinary
+         * subscribers. Command id 0xFFFF is reserved for it. Must be set
+         * before publishing from other threads.
+         */
+        void enableAggregation(size_t maxBytes = 256, std::chrono::microseconds maxDelay = std::chrono::microseconds(500));
+
+        /**
+         * Write what is pending and send every frame on its own again
+         */
+        void disableAggregation();
+
+        /**
+         * @return records, superframes and lone frames sent, all zero without aggregation
+         */
+        [[nodiscard]]
+        FrameAggregator::Statistics aggregationStatistics() const;
+
+        /**
+         * Hand every publish to a writer thread through a bounded lock-free
+         * queue, so publishers never block on the tty. Must be set before
+         * publishing from other threads.
+         */
+        void enableAsyncSend(const SendQueue::Options & options = SendQueue::Options());
+
+        /**
+         * Drain the queue and go back to writing on the publishing thread
+         */
+        void disableAsyncSend();
+
+        [[nodiscard]]
+        SendQueue::Statistics sendQueueStatistics() const;
+
+        /**
+         * Queue frames by the priority their command was advertised with
+         * and write the highest priority first. Lower priority lanes get
+         * the line for at most `timeSlice` at a time, their payloads too
+         * long for one slice are sent as fragments with command id
+         * 0xFFFE that any receiver reassembles. High priority frames and
+         * `PublishBatch` are never split, only normal priority payloads
+         * are aggregated. Takes the place of the send queue and coalescing
+         * while enabled. Must be set before publishing from other threads.
+         */
+        void enablePriorityLanes(const PrioritySender::Options & options = PrioritySender::Options());
+
+        /**
+         * Write what is queued and go back to a single send path
+         */
+        void disablePriorityLanes();
+
+        [[nodiscard]]
+        PrioritySender::Statistics priorityLaneStatistics() const;
+
+        /**
+         * Number every frame sent and keep it until the peer acknowledges
+         * it, writing it again when reported missing or timed out, and
+         * deliver received frames in order without duplicates. Both ends
+         * must enable it, before publishing and receiving. Acknowledgements
+         * use command id 0xFFFD and are the only frames written ahead of
+         * the others by priority lanes, since frames are delivered in the
+         * order they were numbered. Publishes beyond the window wait in a
+         * backlog. `PublishBatch` sends its frames at once.
+         */
+        void enableReliable(const ReliableChannel::Options & options = ReliableChannel::Options());
+
+        /**
+         * Back to fire and forget, frames not acknowledged yet are abandoned
+         */
+        void disableReliable();
+
+        /**
+         * @return all zero without reliable mode
+         */
+        [[nodiscard]]
+        ReliableChannel::Statistics reliableStatistics() const;
+
+        /**
+         * Write any frames held back by aggregation or coalescing and wait
+         * until the priority lanes and the asynchronous send queue have
+         * written everything published so far
+         */
+        void flush();
+
+        /**
+         * Subscribe before receiving starts, the dispatch table is not
+         * locked against the receiving thread
+         */
         template <uint16_t Cmd, typename CmdData>
         func subscribe(Callback<CmdData> callback) -> void
         {
-            SubscriberPtr subscriber = std::make_shared<Subscriber<Cmd, CmdData>>(callback);
-            subscribers[Cmd] = subscriber;
+            auto subscriber = std::make_unique<Subscriber<Cmd, CmdData>>(std::move(callback));
+            dispatchTable.set(Cmd, &Subscriber<Cmd, CmdData>::receive, subscriber.get(), sizeof(CmdData));
+            subscribers[Cmd] = std::move(subscriber);
         }
 
-        bool startReceiving();
-        bool startReceivingAsync();
+        /**
+         * Like `subscribe`, but the callback gets a reference counted view
+         * of the pooled payload that it may keep or hand to another thread
+         * without copying
+         */
+        template <uint16_t Cmd, typename CmdData>
+        func subscribe(SharedCallback<CmdData> callback) -> void
+        {
+            auto subscriber = std::make_unique<SharedSubscriber<Cmd, CmdData>>(std::move(callback));
+            dispatchTable.set(Cmd, &SharedSubscriber<Cmd, CmdData>::receive, subscriber.get(), sizeof(CmdData));
+            subscribers[Cmd] = std::move(subscriber);
+        }
+
+        struct DeltaStatistics
+        {
+            uint64_t keyframesSent;
+            uint64_t deltasSent;
+            uint64_t bytesSaved;          // DATA bytes not sent thanks to deltas
+            uint64_t keyframesReceived;
+            uint64_t deltasReceived;
+            uint64_t dropped;             // deltas received without their base value
+        };
+
+        /**
+         * Send and receive `Cmd` in delta mode: a publish sends only the
+         * bytes that changed since the previous one when that is shorter,
+         * with a full keyframe every `keyframeInterval` frames or
+         * `keyframePeriod`. Both ends must enable it, before publishing
+         * and receiving. A receiver that misses a frame drops deltas
+         * until the next keyframe. `PublishBatch` writes frames of the
+         * command at once, a full frame outside the encoder would replace
+         * the receiver's keyframe and make the deltas after it stale.
+         */
+        template <uint16_t Cmd, typename CmdData>
+        func enableDelta(const DeltaOptions & options = DeltaOptions()) -> void
+        {
+            static_assert(std::is_trivially_copyable_v<CmdData>, "delta mode compares raw bytes");
+            static_assert(sizeof(CmdData) <= DynamicCommandFrame::MAX_DATA_SIZE, "type does not fit a frame");
+            static_assert(sizeof(CmdData) > DeltaEncoder::HEADER_SIZE, "no delta is shorter than a value this small");
+            this->deltaChannels[Cmd] = std::make_unique<DeltaChannel>(sizeof(CmdData), options);
+        }
+
+        /**
+         * @return delta mode counters of a command, all zero if it is not in delta mode
+         */
+        [[nodiscard]]
+        DeltaStatistics deltaStatistics(uint16_t commandId) const;
 
-        inline void stopReceiving()
+        /**
+         * Subscribe to frames of a variable number of `CmdData` elements.
+         * Frames with fewer than `minCount` or more than `maxCount`
+         * elements, or a DLEN that is not a whole number of elements,
+         * are dropped and counted. The span is only valid in the callback.
+         */
+        template <uint16_t Cmd, typename CmdData>
+        func subscribe(SpanCallback<CmdData> callback, size_t minCount = 0,
+                       size_t maxCount = DynamicCommandFrame::MAX_DATA_SIZE / sizeof(CmdData)) -> void
         {
-            this->receivingStateFlag = false;
+            static_assert(sizeof(CmdData) <= DynamicCommandFrame::MAX_DATA_SIZE, "element does not fit a frame");
+            auto subscriber = std::make_unique<SpanSubscriber<Cmd, CmdData>>(std::move(callback));
+            size_t maxLength = std::min(maxCount * sizeof(CmdData), DynamicCommandFrame::MAX_DATA_SIZE);
+            dispatchTable.set(Cmd, &SpanSubscriber<Cmd, CmdData>::receive, subscriber.get(),
+                              (uint16_t) std::min(minCount * sizeof(CmdData), maxLength),
+                              (uint16_t) maxLength, (uint16_t) sizeof(CmdData));
+            subscribers[Cmd] = std::move(subscriber);
         }
 
+        /**
+         * Let coroutines `co_await next<Cmd, CmdData>()` instead of
+         * subscribing to `Cmd`. Call before receiving starts.
+         */
+        template <uint16_t Cmd, typename CmdData>
+        func enableNext() -> void
+        {
+            static_assert(std::is_trivially_copyable_v<CmdData>, "copied out of the frame");
+            auto waiters = std::make_unique<FrameWaiters>();
+            this->subscribers.erase(Cmd);
+            dispatchTable.set(Cmd, &FrameWaiters::receive, waiters.get(), sizeof(CmdData));
+            this->frameWaiters[Cmd] = std::move(waiters);
+        }
+
+        /**
+         * `co_await` the next `Cmd` frame, after `enableNext`, see serial/Coroutine.hpp
+         */
+        template <uint16_t Cmd, typename CmdData>
+        auto next();
+
+        /**
+         * Call `waiter` once with the next frame of `commandId`, on the
+         * thread that dispatches it
+         * @return false if `enableNext` was not called for `commandId`
+         */
+        bool waitFrame(uint16_t commandId, const FrameWaiters::Waiter & waiter);
+
+        /**
+         * Call `waiter` once a publish is sent at once instead of waiting
+         * for the reliable window
+         * @return true if it is already, always without reliable mode
+         */
+        bool whenSendable(const ReliableChannel::RoomWaiter & waiter);
+
+        /**
+         * Size the pool received payloads are copied into, call before
+         * receiving starts. Frames still held by subscribers stay valid.
+         */
+        void setFramePool(const FramePool::Options & options);
+
+        [[nodiscard]]
+        FramePool::Statistics framePoolStatistics() const;
+
+        /**
+         * Select read mode, busy polling, CPU pinning and SCHED_FIFO for
+         * the receiving threads. Port settings apply at once and after
+         * every reconnect, thread settings when receiving starts. The
+         * DLEN limit applies at once, set it before receiving starts.
+         */
+        void setReceiveOptions(const ReceiveOptions & options);
+
+        /**
+         * Receive through a ring of `bytes`: one thread only drains the
+         * port into it while the receiving thread parses and dispatches,
+         * so the kernel buffer keeps draining during slow callbacks.
+         * 0 reads and parses on one thread. Call before receiving starts.
+         */
+        void setReceiveRing(size_t bytes);
+
+        /**
+         * @return ring fill high-water mark and stalls, all zero without a ring
+         */
+        [[nodiscard]]
+        ByteRing::Statistics receiveRingStatistics() const;
+
+        /**
+         * Run subscriber callbacks on worker threads instead of the
+         * receiving thread. Callbacks of one command id stay in order,
+         * different ids may run in parallel. Compile-time routes keep
+         * running on the receiving thread. Call before receiving starts.
+         */
+        void enableExecutor(const CallbackExecutor::Options & options = CallbackExecutor::Options());
+
+        /**
+         * Wait for every queued callback, then run callbacks inline again
+         */
+        void disableExecutor();
+
+        /**
+         * @return backlog and drop counters per command id, empty without an executor
+         */
+        [[nodiscard]]
+        std::unordered_map<uint16_t, CallbackExecutor::CommandStatistics> executorStatistics();
+
+        /**
+         * Link counters (bytes, CRC failures, resyncs, discarded bytes) and
+         * per-command frame counts with latency and callback duration
+         * histograms. The receiving threads update them without locking,
+         * `stats().snapshot()` copies them out, `stats().reset()` zeroes them.
+         */
+        inline LinkStatistics & stats()
+        {
+            return this->linkStatistics;
+        }
+
+        /**
+         * Record every chunk read from or written to the port, with its
+         * time, into a capture file until `stopCapture`
+         * @return false if the file cannot be created
+         */
+        bool startCapture(const String & path);
+
+        void stopCapture();
+
+        /**
+         * Feed the received chunks of a capture through the decoder and
+         * the subscribers on the calling thread, not while receiving
+         * @return chunks, bytes and frames replayed and the frame rate
+         */
+        ReplayResult replay(const String & path, const ReplayOptions & options = ReplayOptions());
+
+        /**
+         * Dispatch through a compile-time `command::Routes<...>` registry
+         * first, ids it does not route still reach `subscribe`d callbacks
+         */
+        template <typename RouteSet>
+        func route() -> void
+        {
+            this->routes = &RouteSet::dispatch;
+        }
+
+        bool startReceiving();
+        bool startReceivingAsync();
+
+        void stopReceiving();
+
         Thread & getReceivingDaemonThread();
 
         inline bool isReceiving() const
@@ -186,9 +1034,23 @@ namespace serial
         {
             this->sof = sofVal;
         }
+
+        /**
+         * Frame with SOF (the default) or COBS and a 0x00 delimiter, both
+         * ends must agree. Set before publishing and receiving.
+         */
+        void setFraming(Framing value);
+
+        [[nodiscard]]
+        inline Framing getFraming() const
+        {
+            return this->framing;
+        }
     };
 
     #undef func
 }
 
+#include "serial/Coroutine.hpp"
+
 #endif // SERIAL_COMM_HANDLE_HPP
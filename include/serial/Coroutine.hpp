@@ -0,0 +1,192 @@
+#ifndef SERIAL_COROUTINE_HPP
+#define SERIAL_COROUTINE_HPP
+
+#include "serial/CommHandle.hpp"
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#include <atomic>
+#include <coroutine>
+#include <cstring>
+#include <stdexcept>
+
+namespace serial
+{
+    /**
+     * Awaits the next `Cmd` frame of `CommHandle::next`. The coroutine
+     * resumes on the thread dispatching the frame, the receiving thread
+     * or an executor worker, with a copy of its DATA.
+     */
+    template <uint16_t Cmd, typename CmdData>
+    class NextFrameAwaiter
+    {
+      private:
+
+        CommHandle* handle;
+        CmdData value;
+        std::coroutine_handle<> continuation;
+        bool enabled = true;
+
+        static void resume(void* context, const command::FrameView & frame)
+        {
+            auto* awaiter = static_cast<NextFrameAwaiter*>(context);
+            std::memcpy(&awaiter->value, frame.data, sizeof(CmdData));
+            awaiter->continuation.resume();
+        }
+
+      public:
+
+        explicit NextFrameAwaiter(CommHandle* handle) : handle(handle) {}
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine)
+        {
+            this->continuation = coroutine;
+            // once added the awaiter may already be resumed and gone
+            bool waiting = this->handle->waitFrame(Cmd, FrameWaiters::Waiter { &NextFrameAwaiter::resume, this });
+            if (!waiting) {
+                this->enabled = false;
+            }
+            return waiting;
+        }
+
+        CmdData await_resume()
+        {
+            if (!this->enabled) {
+                throw std::logic_error("enableNext was not called for the command");
+            }
+            return this->value;
+        }
+    };
+
+    /**
+     * Awaits room in the reliable window of `Publisher::publishAsync`,
+     * then publishes. The coroutine resumes on the receiving thread
+     * handling the acknowledgement that made room, or on the reliable
+     * timer thread, and does not suspend without reliable mode.
+     */
+    template <uint16_t Cmd, typename CmdData>
+    class PublishAwaiter
+    {
+      private:
+
+        CommHandle::Publisher<Cmd, CmdData> publisher;
+        CommHandle* handle;
+        CmdData data;
+        std::coroutine_handle<> continuation;
+
+        static void resume(void* context)
+        {
+            static_cast<PublishAwaiter*>(context)->continuation.resume();
+        }
+
+      public:
+
+        PublishAwaiter(const CommHandle::Publisher<Cmd, CmdData> & publisher, CommHandle* handle, const CmdData & data)
+            : publisher(publisher), handle(handle), data(data) {}
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine)
+        {
+            this->continuation = coroutine;
+            return !this->handle->whenSendable(ReliableChannel::RoomWaiter { &PublishAwaiter::resume, this });
+        }
+
+        bool await_resume()
+        {
+            return this->publisher.publish(this->data);
+        }
+    };
+
+    /**
+     * Awaits the response of `Caller::callAsync`. The coroutine resumes
+     * on the receiving thread with the response, or on the timer wheel's
+     * thread once the timeout passed.
+     */
+    template <uint16_t ReqCmd, typename Req, uint16_t RespCmd, typename Resp>
+    class CallAwaiter
+    {
+      private:
+
+        enum State : uint8_t
+        {
+            STARTING,
+            SUSPENDED,
+            COMPLETED,
+        };
+
+        CommHandle::Caller<ReqCmd, Req, RespCmd, Resp> caller;
+        Req request;
+        std::chrono::microseconds timeout;
+        CallTable::Outcome outcome = CallTable::Outcome::NOT_SENT;
+        Resp response;
+        std::coroutine_handle<> continuation;
+        std::atomic<uint8_t> state { STARTING };   // the call may complete before the coroutine suspended
+
+      public:
+
+        CallAwaiter(const CommHandle::Caller<ReqCmd, Req, RespCmd, Resp> & caller, const Req & request,
+                    std::chrono::microseconds timeout) : caller(caller), request(request), timeout(timeout) {}
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine)
+        {
+            this->continuation = coroutine;
+            this->caller.call(this->request, this->timeout, [this](CallTable::Outcome outcome, const CallTable::byte_t* data) {
+                this->outcome = outcome;
+                if (outcome == CallTable::Outcome::RESPONSE) {
+                    std::memcpy(&this->response, data, sizeof(Resp));
+                }
+                if (this->state.exchange(COMPLETED, std::memory_order_acq_rel) == SUSPENDED) {
+                    this->continuation.resume();
+                }
+            });
+            return this->state.exchange(SUSPENDED, std::memory_order_acq_rel) != COMPLETED;
+        }
+
+        Resp await_resume()
+        {
+            if (this->outcome == CallTable::Outcome::TIMEOUT) {
+                throw CallTimeoutException();
+            }
+            if (this->outcome == CallTable::Outcome::NOT_SENT) {
+                throw CallNotSentException();
+            }
+            return this->response;
+        }
+    };
+
+    template <uint16_t Cmd, typename CmdData>
+    auto CommHandle::next()
+    {
+        return NextFrameAwaiter<Cmd, CmdData>(this);
+    }
+
+    template <uint16_t Cmd, typename CmdData>
+    auto CommHandle::Publisher<Cmd, CmdData>::publishAsync(const CmdData & data)
+    {
+        return PublishAwaiter<Cmd, CmdData>(*this, this->handle, data);
+    }
+
+    template <uint16_t ReqCmd, typename Req, uint16_t RespCmd, typename Resp>
+    auto CommHandle::Caller<ReqCmd, Req, RespCmd, Resp>::callAsync(const Req & request, std::chrono::microseconds timeout)
+    {
+        return CallAwaiter<ReqCmd, Req, RespCmd, Resp>(*this, request, timeout);
+    }
+}
+
+#endif // coroutines
+
+#endif // SERIAL_COROUTINE_HPP
@@ -0,0 +1,100 @@
+#ifndef SERIAL_FRAME_AGGREGATOR_HPP
+#define SERIAL_FRAME_AGGREGATOR_HPP
+
+#include "serial/command/Superframe.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace serial
+{
+    /**
+     * Collects published payloads as superframe records and hands them
+     * to a sink as one frame, either when `maxBytes` of records are
+     * pending or `maxDelay` after the first one. A lone record leaves as
+     * an ordinary frame, so nothing is added when nothing is pending.
+     */
+    class FrameAggregator
+    {
+      public:
+
+        using byte_t = unsigned char;
+        using Duration = std::chrono::microseconds;
+
+        /**
+         * Frames and writes one payload
+         * @return false if the frame was not written whole
+         */
+        using Sink = std::function<bool(uint16_t commandId, const byte_t* data, size_t length)>;
+
+        struct Statistics
+        {
+            uint64_t records;        // payloads appended
+            uint64_t superframes;    // frames that carried more than one record
+            uint64_t singles;        // payloads that left as an ordinary frame
+        };
+
+      private:
+
+        using Clock = std::chrono::steady_clock;
+        using Mutex = std::mutex;
+        using Lock = std::unique_lock<Mutex>;
+
+        Sink sink;
+        size_t maxBytes;
+        Duration maxDelay;
+
+        std::vector<byte_t> buffer;
+        size_t records = 0;
+        Clock::time_point deadline;
+        Statistics statistics {};
+
+        Mutex mutex;
+        std::condition_variable wakeup;
+        std::thread flushThread;
+        bool running = true;
+
+        bool flushLocked();
+
+        void flushDaemon();
+
+      public:
+
+        /**
+         * @param maxBytes DATA of a superframe, at most 65535
+         */
+        FrameAggregator(Sink sink, size_t maxBytes, Duration maxDelay);
+
+        FrameAggregator(const FrameAggregator &) = delete;
+
+        FrameAggregator & operator=(const FrameAggregator &) = delete;
+
+        /**
+         * Flushes whatever is pending, dropped if the sink throws, and stops the timer thread
+         */
+        ~FrameAggregator();
+
+        /**
+         * Queue a payload, payloads too long for a record are written
+         * at once after the pending ones
+         * @return false if a write this caused failed
+         */
+        bool append(uint16_t commandId, const void* data, size_t length);
+
+        /**
+         * Write the pending records now
+         */
+        bool flush();
+
+        [[nodiscard]]
+        Statistics getStatistics();
+    };
+}
+
+#endif // SERIAL_FRAME_AGGREGATOR_HPP
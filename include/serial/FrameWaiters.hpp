@@ -0,0 +1,51 @@
+#ifndef SERIAL_FRAME_WAITERS_HPP
+#define SERIAL_FRAME_WAITERS_HPP
+
+#include "serial/command/FrameDecoder.hpp"
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace serial
+{
+    /**
+     * One-shot waiters for the next frame of a command. Each waiter is
+     * called once, on the thread dispatching the frame, so a suspended
+     * coroutine resumes there without a thread hop. Frames arriving
+     * while nobody waits are not kept.
+     */
+    class FrameWaiters
+    {
+      public:
+
+        struct Waiter
+        {
+            void (*resume)(void* context, const command::FrameView & frame);
+            void* context;
+        };
+
+      private:
+
+        std::mutex mutex;
+        std::vector<Waiter> waiting;
+        std::vector<Waiter> resuming;     // dispatching thread only
+
+      public:
+
+        void add(const Waiter & waiter);
+
+        /**
+         * @return waiters not called yet
+         */
+        [[nodiscard]]
+        size_t size();
+
+        /**
+         * Dispatch target, calls every waiter added before the frame came
+         */
+        static void receive(void* target, const command::FrameView & frame);
+    };
+}
+
+#endif // SERIAL_FRAME_WAITERS_HPP
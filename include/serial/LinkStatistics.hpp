@@ -0,0 +1,190 @@
+#ifndef SERIAL_LINK_STATISTICS_HPP
+#define SERIAL_LINK_STATISTICS_HPP
+
+#include "serial/command/FrameDecoder.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace serial
+{
+    /**
+     * Log-linear histogram of durations in nanoseconds, laid out like
+     * HdrHistogram: every power of two is split into 16 linear buckets,
+     * so a reported value is within 1/16 of what was recorded. Recording
+     * is a few relaxed atomic increments, any thread may record or read.
+     */
+    class LatencyHistogram
+    {
+      public:
+
+        static constexpr unsigned SUB_BUCKET_BITS = 4;
+        static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+        static constexpr unsigned MAX_MAGNITUDE = 35;  // longer values count as ~68.7 s
+        static constexpr size_t BUCKETS = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+        struct Snapshot
+        {
+            uint64_t count;
+            uint64_t min;
+            uint64_t max;
+            uint64_t sum;
+            std::vector<uint64_t> buckets;
+
+            /**
+             * @param percentile 0 to 100
+             * @return upper bound of the bucket holding that rank, 0 if empty
+             */
+            [[nodiscard]]
+            uint64_t percentile(double percentile) const;
+
+            [[nodiscard]]
+            double mean() const;
+        };
+
+      private:
+
+        std::array<std::atomic<uint64_t>, BUCKETS> counts {};
+        std::atomic<uint64_t> sum { 0 };
+        std::atomic<uint64_t> min { UINT64_MAX };
+        std::atomic<uint64_t> max { 0 };
+
+      public:
+
+        LatencyHistogram() = default;
+
+        LatencyHistogram(const LatencyHistogram &) = delete;
+
+        LatencyHistogram & operator=(const LatencyHistogram &) = delete;
+
+        void record(uint64_t nanoseconds);
+
+        [[nodiscard]]
+        Snapshot snapshot() const;
+
+        void reset();
+
+        static size_t bucketOf(uint64_t value);
+
+        /**
+         * @return largest value counted in bucket `index`
+         */
+        static uint64_t bucketLimit(size_t index);
+    };
+
+    /**
+     * Counters of a receiving link. The receiving threads update them
+     * with relaxed atomics and never lock, so they can stay on in
+     * production. A snapshot is not taken atomically as a whole, counters
+     * read while frames arrive may be off by the frames in flight.
+     */
+    class LinkStatistics
+    {
+      public:
+
+        using Clock = std::chrono::steady_clock;
+
+        struct CommandSnapshot
+        {
+            uint64_t frames;
+            uint64_t bytes;
+            uint64_t shortFrames;       // dropped, DLEN below the subscribed type
+            uint64_t badLengthFrames;   // dropped, DLEN above the subscribed maximum or not whole elements
+            uint64_t unhandled;         // dropped, nobody subscribed
+            uint64_t incomplete;        // dropped, a fragment of the payload went missing
+            LatencyHistogram::Snapshot latency;           // decoded until the callback started
+            LatencyHistogram::Snapshot callbackDuration;
+        };
+
+        struct Snapshot
+        {
+            uint64_t bytesReceived;
+            uint64_t frames;
+            uint64_t crc8Failures;
+            uint64_t crc16Failures;
+            uint64_t oversizedFrames;
+            uint64_t resyncs;
+            uint64_t bytesDiscarded;
+            std::map<uint16_t, CommandSnapshot> commands;  // every id seen since the last reset
+        };
+
+        struct Command
+        {
+            std::atomic<uint64_t> frames { 0 };
+            std::atomic<uint64_t> bytes { 0 };
+            std::atomic<uint64_t> shortFrames { 0 };
+            std::atomic<uint64_t> badLengthFrames { 0 };
+            std::atomic<uint64_t> unhandled { 0 };
+            std::atomic<uint64_t> incomplete { 0 };
+            LatencyHistogram latency;
+            LatencyHistogram callbackDuration;
+
+            /**
+             * Record one callback that ran from `start` to `end` for a
+             * frame decoded at `decoded`
+             */
+            void called(Clock::time_point decoded, Clock::time_point start, Clock::time_point end);
+        };
+
+      private:
+
+        struct Page
+        {
+            std::array<std::atomic<Command*>, 256> commands {};
+        };
+
+        std::array<std::atomic<Page*>, 256> pages {};
+
+        std::atomic<uint64_t> bytesReceived { 0 };
+        std::atomic<uint64_t> frames { 0 };
+        std::atomic<uint64_t> crc8Failures { 0 };
+        std::atomic<uint64_t> crc16Failures { 0 };
+        std::atomic<uint64_t> oversizedFrames { 0 };
+        std::atomic<uint64_t> resyncs { 0 };
+        std::atomic<uint64_t> bytesDiscarded { 0 };
+
+        // decoder totals at the last `decoded` call, touched by the parser only
+        command::FrameDecoder::Statistics published {};
+
+      public:
+
+        LinkStatistics() = default;
+
+        LinkStatistics(const LinkStatistics &) = delete;
+
+        LinkStatistics & operator=(const LinkStatistics &) = delete;
+
+        ~LinkStatistics();
+
+        /**
+         * Counters of one command id, created on first use without locking
+         */
+        Command & command(uint16_t commandId);
+
+        inline void received(size_t bytes)
+        {
+            this->bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        /**
+         * Add what the decoder counted since the previous call, only
+         * the thread feeding the decoder may call this
+         */
+        void decoded(const command::FrameDecoder::Statistics & totals);
+
+        [[nodiscard]]
+        Snapshot snapshot() const;
+
+        /**
+         * Zero every counter and histogram, safe while receiving
+         */
+        void reset();
+    };
+}
+
+#endif // SERIAL_LINK_STATISTICS_HPP
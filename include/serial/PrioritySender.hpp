@@ -0,0 +1,212 @@
+#ifndef SERIAL_PRIORITY_SENDER_HPP
+#define SERIAL_PRIORITY_SENDER_HPP
+
+#include "serial/SendQueue.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace serial
+{
+    /**
+     * Send priority of a command, chosen when it is advertised
+     */
+    enum class Priority : uint8_t
+    {
+        HIGH = 0,       // written as soon as the line is free, never split
+        NORMAL = 1,
+        BULK = 2,       // only written when nothing else is waiting
+    };
+
+    /**
+     * One queue of encoded frames per priority, drained by a writer
+     * thread that always writes the highest priority frames first.
+     * Frames of the lower lanes are written at most `timeSlice` worth of
+     * line time at a time, and the next slice waits until the previous
+     * one should have left the wire, so a high priority frame never
+     * finds more than one slice ahead of it in the driver.
+     */
+    class PrioritySender
+    {
+      public:
+
+        using byte_t = unsigned char;
+        using Duration = std::chrono::microseconds;
+
+        static constexpr size_t LANES = 3;
+        static constexpr size_t MIN_SLICE_BYTES = 64;
+
+        /**
+         * Writes the given buffers with a single syscall
+         * @return number of bytes written
+         */
+        using Sink = std::function<int(const struct iovec*, int)>;
+
+        struct Options
+        {
+            size_t capacity = 256;                            // transfers per lane
+            OverflowPolicy overflow = OverflowPolicy::BLOCK;
+            Duration timeSlice = Duration(10000);             // line time given to a lower lane at once
+            size_t bytesPerSecond = 11520;                    // line rate, baud / 10 for 8N1
+            int maxGather = 64;                               // frames per write
+        };
+
+        struct LaneStatistics
+        {
+            uint64_t enqueued;        // transfers
+            uint64_t written;         // frames
+            uint64_t dropped;         // transfers
+            size_t depth;
+            size_t maxDepth;
+        };
+
+        struct Statistics
+        {
+            std::array<LaneStatistics, LANES> lanes;
+            uint64_t preemptions;     // high priority writes made while lower lanes waited
+            uint64_t writeFailures;
+        };
+
+        /**
+         * Frames that are written in order and never dropped apart, such
+         * as the pieces of one payload. Other lanes may be written
+         * between them.
+         */
+        class Transfer
+        {
+          private:
+
+            std::vector<byte_t> bytes;
+            std::vector<size_t> ends;     // end offset of every frame
+            size_t next = 0;              // first frame not written yet
+
+            friend class PrioritySender;
+
+          public:
+
+            void append(const struct iovec* buffers, int count);
+
+            [[nodiscard]]
+            inline bool empty() const
+            {
+                return this->ends.empty();
+            }
+
+            void clear();
+
+            /**
+             * @return bytes not written yet
+             */
+            [[nodiscard]]
+            size_t remaining() const;
+        };
+
+      private:
+
+        using Clock = std::chrono::steady_clock;
+        using Mutex = std::mutex;
+        using Lock = std::unique_lock<Mutex>;
+
+        struct Lane
+        {
+            std::deque<Transfer> queue;
+            uint64_t pushed = 0;      // transfers, dropped ones included
+            uint64_t done = 0;        // transfers written or dropped
+            uint64_t written = 0;
+            uint64_t dropped = 0;
+            size_t maxDepth = 0;
+            size_t bytes = 0;         // queued, not written yet
+        };
+
+        Sink sink;
+        Options options;
+        size_t sliceBytes;
+
+        std::array<Lane, LANES> lanes;
+        std::vector<Transfer> spare;  // cleared transfers keeping their storage
+        Clock::time_point lineFreeAt;
+        uint64_t preemptions = 0;
+        uint64_t writeFailures = 0;
+        bool running = true;
+
+        mutable Mutex mutex;
+        std::condition_variable wakeup;      // the writer
+        std::condition_variable progress;    // producers waiting for room or a flush
+        std::thread writerThread;
+
+        Transfer takeSpare();
+
+        void recycle(Transfer && transfer);
+
+        bool enqueue(Lock & lock, Priority priority, Transfer && transfer);
+
+        void writerDaemon();
+
+      public:
+
+        PrioritySender(Sink sink, const Options & options);
+
+        PrioritySender(const PrioritySender &) = delete;
+
+        PrioritySender & operator=(const PrioritySender &) = delete;
+
+        /**
+         * Writes everything still queued, then stops the writer thread
+         */
+        ~PrioritySender();
+
+        /**
+         * Queue one encoded frame given as `count` buffers
+         * @return false if the frame was dropped
+         */
+        bool push(Priority priority, const struct iovec* buffers, int count);
+
+        /**
+         * Queue frames that must be written in order
+         * @return false if the transfer was dropped
+         */
+        bool push(Priority priority, Transfer && transfer);
+
+        /**
+         * An empty transfer to fill for `push`, reusing released storage
+         */
+        Transfer transfer();
+
+        /**
+         * Block until every transfer pushed before this call is written or dropped
+         */
+        void flush();
+
+        /**
+         * @return most bytes written from a lower lane at once, frames
+         *     longer than that should be split by the caller
+         */
+        [[nodiscard]]
+        inline size_t slice() const
+        {
+            return this->sliceBytes;
+        }
+
+        /**
+         * @return line time until a frame pushed now with `priority` would
+         *     start being written, if nothing of a higher priority comes
+         */
+        [[nodiscard]]
+        Duration backlog(Priority priority) const;
+
+        [[nodiscard]]
+        Statistics statistics() const;
+    };
+}
+
+#endif // SERIAL_PRIORITY_SENDER_HPP
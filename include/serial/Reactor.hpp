@@ -0,0 +1,126 @@
+#ifndef SERIAL_REACTOR_HPP
+#define SERIAL_REACTOR_HPP
+
+#include "serial/CommHandle.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace serial
+{
+    /**
+     * epoll based event loop that services the receive side of many
+     * `CommHandle`s from a fixed number of threads. Handles are spread
+     * over the threads, every thread owns its own epoll instance, so a
+     * handle is always serviced by the same thread. A handle that lost
+     * its port is unwatched and reopened once per `RETRY_INTERVAL` from
+     * the epoll timeout, the other handles of its thread keep running.
+     */
+    class Reactor
+    {
+      private:
+
+        using Mutex = std::recursive_mutex;
+        using Lock = std::lock_guard<Mutex>;
+        using Clock = std::chrono::steady_clock;
+
+        struct Registration
+        {
+            int fd;
+            uint32_t connection;
+            bool reconnecting = false;    // port lost, fd no longer watched
+            Clock::time_point retryAt;
+        };
+
+        struct Shard
+        {
+            int epollFd = -1;
+            int wakeFd = -1;
+            Mutex mutex;
+            std::unordered_map<CommHandle*, Registration> handles;
+            size_t reconnecting = 0;
+            std::vector<byte_t> buffer;
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::atomic_bool running { false };
+
+        void loop(Shard & shard);
+
+        void service(Shard & shard, CommHandle* handle, uint32_t events);
+
+        /**
+         * Stop watching a handle whose port is gone and close the port
+         */
+        void suspend(Shard & shard, CommHandle* handle);
+
+        /**
+         * Watch the handle's current descriptor, after a reconnect
+         */
+        void watch(Shard & shard, CommHandle* handle);
+
+        /**
+         * Try to reopen the ports of suspended handles that are due
+         * @return milliseconds until the next retry, -1 if none is waiting
+         */
+        int retryReconnects(Shard & shard);
+
+        void detach(Shard & shard, CommHandle* handle);
+
+      public:
+
+        static constexpr std::chrono::milliseconds RETRY_INTERVAL { 1000 };
+
+        /**
+         * @param threads number of event loop threads
+         * @param bufferSize bytes read per readiness event
+         */
+        explicit Reactor(size_t threads = 1, size_t bufferSize = 4096);
+
+        Reactor(const Reactor &) = delete;
+
+        Reactor & operator=(const Reactor &) = delete;
+
+        /**
+         * Stops the loops and releases every registered handle
+         */
+        ~Reactor();
+
+        /**
+         * Register a handle, its port is read by the reactor from now on
+         * @return false if the handle is already receiving
+         */
+        bool add(CommHandle & handle);
+
+        /**
+         * Unregister a handle, safe to call from a subscriber callback
+         */
+        void remove(CommHandle & handle);
+
+        /**
+         * Spawn one thread per shard and return
+         */
+        bool start();
+
+        /**
+         * Service the first shard on the calling thread until `stop()`,
+         * the other shards get their own threads
+         */
+        void run();
+
+        void stop();
+
+        /**
+         * @return number of registered handles
+         */
+        size_t size();
+    };
+}
+
+#endif // SERIAL_REACTOR_HPP
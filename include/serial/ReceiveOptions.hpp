@@ -0,0 +1,27 @@
+#ifndef SERIAL_RECEIVE_OPTIONS_HPP
+#define SERIAL_RECEIVE_OPTIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace serial
+{
+    /**
+     * How the receiving side of a `CommHandle` trades CPU for latency.
+     * The defaults match a plain blocking read.
+     */
+    struct ReceiveOptions
+    {
+        uint8_t vmin = 1;               // bytes a blocking read waits for
+        uint8_t vtime = 0;              // inter-byte timeout, tenths of a second
+        bool busyPoll = false;          // reads return at once and are retried in a spin loop, one core stays busy
+        bool lowLatency = false;        // ASYNC_LOW_LATENCY, ignored if the driver lacks it
+        size_t bufferSize = 1024;       // bytes per read without a receive ring
+        size_t maxDataLength = UINT16_MAX;  // a longer DLEN is taken for corruption, the decoder resyncs at once
+        int cpu = -1;                   // pin the receiving thread, -1 leaves it floating
+        int readerCpu = -1;             // pin the receive ring's reader thread
+        int realtimePriority = 0;       // SCHED_FIFO priority 1..99 for both, 0 keeps the default policy
+    };
+}
+
+#endif // SERIAL_RECEIVE_OPTIONS_HPP
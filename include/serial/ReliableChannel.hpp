@@ -0,0 +1,324 @@
+#ifndef SERIAL_RELIABLE_CHANNEL_HPP
+#define SERIAL_RELIABLE_CHANNEL_HPP
+
+#include "serial/PrioritySender.hpp"
+#include "serial/command/FrameDecoder.hpp"
+#include "serial/command/FramePool.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace serial
+{
+    /**
+     * Selective repeat over the 8 bit SEQ of every frame. The sender
+     * keeps up to `window` numbered frames until they are acknowledged
+     * and writes again those the receiver reports missing or that time
+     * out. The receiver delivers frames in sequence order, holding the
+     * ones that arrive after a gap and dropping duplicates. Both ends
+     * number from 0, a frame far ahead of the window means the peer
+     * started over and the receiver follows it.
+     *
+     * An acknowledgement is a frame with command id `ACK_COMMAND` and
+     * SEQ 0 outside the numbering. Its DATA is the next sequence number
+     * expected in order, then a little endian bitmap of the 32 after
+     * it, bit 0 for next + 1. A clear bit below a set one is a NACK.
+     */
+    class ReliableChannel
+    {
+      public:
+
+        using byte_t = unsigned char;
+        using Duration = std::chrono::microseconds;
+
+        static constexpr uint16_t ACK_COMMAND = 0xFFFD;   // reserved, never dispatched
+        static constexpr size_t ACK_SIZE = 5;
+        static constexpr size_t MAX_WINDOW = 32;
+
+        /**
+         * Puts the whole encoded frame of a payload with the given SEQ into `frame`
+         */
+        using Encoder = std::function<void(uint16_t commandId, const byte_t* data, size_t length, byte_t sequence,
+                                           std::vector<byte_t> & frame)>;
+
+        /**
+         * Writes one encoded frame
+         * @return false if it was not written whole
+         */
+        using Writer = std::function<bool(const byte_t* frame, size_t size, Priority priority)>;
+
+        /**
+         * Sends the DATA of an acknowledgement
+         */
+        using AckWriter = std::function<void(const byte_t* data, size_t size)>;
+
+        /**
+         * Hands a frame, in sequence order, to the subscribers
+         */
+        using Deliverer = std::function<void(const command::FrameView & frame)>;
+
+        /**
+         * @return how long a frame written now waits before it goes on the
+         *     wire, the round trip and timeouts are counted from then
+         */
+        using Backlog = std::function<Duration(Priority priority)>;
+
+        /**
+         * Called once the window has room again, on the thread that made
+         * it: the receiving thread handling an ACK, or the timer thread
+         */
+        struct RoomWaiter
+        {
+            void (*resume)(void* context);
+            void* context;
+        };
+
+        struct Options
+        {
+            size_t window = 32;                                // frames in flight, at most `MAX_WINDOW`
+            size_t backlog = 256;                              // frames waiting for the window, then `send` blocks, unless HIGH
+            Duration initialTimeout = Duration(200000);        // until the round trip is measured
+            Duration minTimeout = Duration(10000);
+            Duration maxTimeout = Duration(2000000);
+            int maxRetries = 8;                                // timeouts of one frame, then it is given up
+            Duration ackDelay = Duration(2000);                // longest an in order frame waits for its ACK
+            size_t ackEvery = 8;                               // frames acknowledged at once
+            Duration gapTimeout = Duration(3000000);           // longest frames wait behind a missing one
+        };
+
+        struct Statistics
+        {
+            uint64_t sent;
+            uint64_t retransmitted;
+            uint64_t expired;         // given up after `maxRetries`
+            uint64_t acknowledged;
+            uint64_t acksReceived;
+            uint64_t delivered;
+            uint64_t duplicates;      // received again and dropped
+            uint64_t held;            // received after a gap
+            uint64_t skipped;         // sequence numbers given up on by the receiver
+            uint64_t resyncs;         // the peer's numbering jumped, it restarted
+            uint64_t acksSent;
+            size_t inFlight;
+            size_t waiting;           // for the window
+            size_t roomWaiters;       // `whenRoom` waiters not called yet
+            Duration roundTrip;       // smoothed
+            Duration timeout;         // retransmission timeout before backoff
+        };
+
+      private:
+
+        using Clock = std::chrono::steady_clock;
+        using Mutex = std::mutex;
+        using Lock = std::unique_lock<Mutex>;
+
+        enum class SlotState : uint8_t
+        {
+            FREE,
+            PENDING,      // numbered and written, waiting for its ACK
+        };
+
+        struct Slot
+        {
+            std::vector<byte_t> bytes;
+            Clock::time_point sentAt;     // when it should leave for the wire
+            Priority priority = Priority::NORMAL;
+            SlotState state = SlotState::FREE;
+            uint8_t sequence = 0;
+            int retries = 0;
+            int timeouts = 0;     // retransmissions on timeout, each doubles the next wait
+            bool nacked = false;  // reported missing, written again by the timer thread
+        };
+
+        struct Retransmission
+        {
+            std::vector<byte_t> bytes;
+            Priority priority;
+        };
+
+        struct Waiting
+        {
+            uint16_t commandId;
+            std::vector<byte_t> payload;
+            Priority priority;
+        };
+
+        Encoder encoder;
+        Writer writer;
+        AckWriter ackWriter;
+        Deliverer deliverer;
+        Backlog backlog;
+        command::FramePool* pool;
+        Options options;
+
+        // sender, `orderMutex` keeps numbering and writing in the same order
+        Mutex orderMutex;
+        Mutex senderMutex;
+        std::condition_variable room;        // in the backlog
+        std::array<Slot, MAX_WINDOW> slots;
+        std::deque<Waiting> waiting;
+        std::deque<RoomWaiter> roomWaiters;
+        uint8_t base = 0;             // oldest sequence number not acknowledged
+        uint8_t nextSequence = 0;
+        Duration smoothedRoundTrip {};
+        Duration roundTripVariance {};
+        Duration timeout;
+        bool measured = false;
+        uint64_t sent = 0;
+        uint64_t retransmitted = 0;
+        uint64_t expired = 0;
+        uint64_t acknowledged = 0;
+        uint64_t acksReceived = 0;
+
+        // receiver, `deliveryMutex` keeps frames released by the receiving and the timer thread in order
+        Mutex deliveryMutex;
+        bool delivering = true;
+        Mutex receiverMutex;
+        std::array<command::FrameBuffer, MAX_WINDOW> heldFrames;
+        std::vector<command::FrameBuffer> ready;
+        uint32_t heldMask = 0;        // bit i holds sequence number expected + i
+        uint8_t expected = 0;         // both ends number from 0, frames of lower lanes may come late
+        Clock::time_point gapSince;
+        size_t unacknowledged = 0;
+        Clock::time_point ackDeadline;
+        uint64_t delivered = 0;
+        uint64_t duplicates = 0;
+        uint64_t held = 0;
+        uint64_t skipped = 0;
+        uint64_t resyncs = 0;
+        uint64_t acksSent = 0;
+
+        bool running = true;
+        uint64_t wakeups = 0;
+        Mutex timerMutex;
+        std::condition_variable timerWakeup;
+        std::thread timerThread;
+
+        [[nodiscard]]
+        bool windowFull() const;
+
+        /**
+         * Number, encode and keep a frame, `senderMutex` held
+         */
+        Slot & number(uint16_t commandId, const byte_t* data, size_t length, Priority priority);
+
+        /**
+         * Number and write waiting frames while the window has room
+         */
+        void drainWaiting();
+
+        /**
+         * Take as many room waiters as frames could be numbered right
+         * away, `senderMutex` held
+         */
+        void takeRoomWaiters(std::vector<RoomWaiter> & resuming);
+
+        /**
+         * Move `base` past the acknowledged and given up frames
+         */
+        void advanceBase();
+
+        void sample(Duration roundTrip);
+
+        /**
+         * Collect the NACKed and timed out frames, or give them up
+         * @return when to look again
+         */
+        Clock::time_point collectRetransmissions(Clock::time_point now, const std::array<Duration, PrioritySender::LANES> & backlogs,
+                                                 std::vector<Retransmission> & retransmissions);
+
+        /**
+         * Deliver held frames from `expected` on, until the next gap
+         */
+        void releaseHeld();
+
+        /**
+         * Give up on the sequence numbers missing for `gapTimeout` and
+         * release the frames held behind them
+         * @return whether a gap was skipped
+         */
+        bool skipGapLocked(Clock::time_point now);
+
+        /**
+         * Skip an expired gap and deliver what it held back, timer thread
+         */
+        void releaseAfterGap(Clock::time_point now);
+
+        void acknowledgementLocked(byte_t (& data)[ACK_SIZE]);
+
+        void wakeTimer();
+
+        void timerDaemon();
+
+      public:
+
+        ReliableChannel(Encoder encoder, Writer writer, AckWriter ackWriter, Deliverer deliverer, Backlog backlog,
+                        command::FramePool* pool, const Options & options);
+
+        ReliableChannel(const ReliableChannel &) = delete;
+
+        ReliableChannel & operator=(const ReliableChannel &) = delete;
+
+        /**
+         * Stops the timer thread, frames not acknowledged yet are abandoned
+         */
+        ~ReliableChannel();
+
+        /**
+         * Number, keep and write a frame, or copy the payload to the
+         * backlog while the window is full. The backlog is numbered lane
+         * by lane, HIGH first, and retransmissions are written in lane
+         * order too. Numbered BULK frames are written in the NORMAL lane,
+         * the peer delivers nothing after them until they arrive.
+         * @param mayWait false to grow the backlog past `backlog` rather
+         *     than wait for acknowledgements, for threads that handle them
+         *     or that their handling waits for
+         * @return false if the first write failed, it is retried like a lost frame
+         */
+        bool send(uint16_t commandId, const void* data, size_t length, Priority priority, bool mayWait = true);
+
+        /**
+         * Wait for a frame to be numbered and written at once, without a
+         * thread blocking: `waiter` is kept and called when the window
+         * has room and the backlog is empty. Waiters are called in order,
+         * as many at a time as frames fit, and never once the channel is
+         * destroyed.
+         * @return true if there is room now, `waiter` is not kept
+         */
+        bool whenRoom(const RoomWaiter & waiter);
+
+        /**
+         * Handle an acknowledgement frame of the peer. Frames are only
+         * written again by the timer thread, so the receiving thread never
+         * waits for room in a full send queue.
+         */
+        void acknowledge(const command::FrameView & frame);
+
+        /**
+         * Handle a numbered frame of the peer, delivering it and any held
+         * behind it in order. Receiving thread only. Frames held behind a
+         * gap the peer gave up on are also released by the timer thread
+         * once `gapTimeout` runs out, when nothing arrives to do it.
+         */
+        void receive(const command::FrameView & frame);
+
+        /**
+         * Deliver nothing from now on, once receiving has stopped. Waits
+         * for a delivery of the timer thread in progress.
+         */
+        void stopDelivery();
+
+        [[nodiscard]]
+        Statistics statistics();
+    };
+}
+
+#endif // SERIAL_RELIABLE_CHANNEL_HPP
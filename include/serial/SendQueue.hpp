@@ -0,0 +1,167 @@
+#ifndef SERIAL_SEND_QUEUE_HPP
+#define SERIAL_SEND_QUEUE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace serial
+{
+    /**
+     * What a producer does when the queue is full
+     */
+    enum class OverflowPolicy : uint8_t
+    {
+        BLOCK,          // wait for the writer to make room
+        DROP_OLDEST,    // discard the oldest queued frame
+        DROP_NEWEST,    // discard the frame being pushed
+    };
+
+    /**
+     * Bounded lock-free queue of encoded frames, drained by a dedicated
+     * writer thread that hands every ready frame to the sink in one
+     * gathered write. Producers only touch atomics on the fast path.
+     */
+    class SendQueue
+    {
+      public:
+
+        using byte_t = unsigned char;
+
+        /**
+         * Writes the given buffers with a single syscall
+         * @return number of bytes written
+         */
+        using Sink = std::function<int(const struct iovec*, int)>;
+
+        struct Options
+        {
+            size_t capacity = 1024;                       // frames, rounded up to a power of two
+            OverflowPolicy overflow = OverflowPolicy::BLOCK;
+            size_t slotReserve = 64;                      // bytes preallocated per slot
+            int maxGather = 64;                           // frames per write
+        };
+
+        struct Statistics
+        {
+            uint64_t enqueued;
+            uint64_t written;
+            uint64_t droppedOldest;
+            uint64_t droppedNewest;
+            uint64_t writeFailures;
+            size_t depth;
+            size_t maxDepth;
+        };
+
+      private:
+
+        using Mutex = std::mutex;
+        using Lock = std::unique_lock<Mutex>;
+
+        struct alignas(64) Slot
+        {
+            std::atomic<size_t> sequence { 0 };
+            std::vector<byte_t> data;
+        };
+
+        Sink sink;
+        Options options;
+
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+
+        alignas(64) std::atomic<size_t> enqueuePos { 0 };
+        alignas(64) std::atomic<size_t> dequeuePos { 0 };
+
+        std::atomic<uint64_t> written { 0 };
+        std::atomic<uint64_t> droppedOldest { 0 };
+        std::atomic<uint64_t> droppedNewest { 0 };
+        std::atomic<uint64_t> writeFailures { 0 };
+        std::atomic<size_t> maxDepth { 0 };
+
+        std::atomic_bool writing { false };
+        std::atomic_bool writerParked { false };
+        std::atomic<int> waiters { 0 };
+        std::atomic_bool running { true };
+
+        Mutex waitMutex;
+        std::condition_variable stateChanged;
+        std::thread writerThread;
+
+        Slot* claimEnqueue(size_t & position);
+
+        Slot* claimDequeue(size_t & position);
+
+        void release(Slot* slot, size_t position);
+
+        void notifyWriter();
+
+        bool hasReady();
+
+        void writerDaemon();
+
+      public:
+
+        SendQueue(Sink sink, const Options & options);
+
+        SendQueue(const SendQueue &) = delete;
+
+        SendQueue & operator=(const SendQueue &) = delete;
+
+        /**
+         * Writes everything still queued, then stops the writer thread
+         */
+        ~SendQueue();
+
+        /**
+         * Copy an encoded frame into the queue
+         * @param data frame bytes
+         * @param size frame size
+         * @return false if the frame was dropped
+         */
+        bool push(const void* data, size_t size);
+
+        /**
+         * Encode straight into queue storage
+         * @param size exact number of bytes `encode` writes
+         * @param encode called with a buffer of `size` bytes
+         * @return false if the frame was dropped
+         */
+        template <typename Encoder>
+        bool emplace(size_t size, Encoder && encode)
+        {
+            size_t position;
+            Slot* slot = this->claimEnqueue(position);
+            if (slot == nullptr) {
+                return false;
+            }
+            slot->data.resize(size);
+            encode(slot->data.data());
+            slot->sequence.store(position + 1, std::memory_order_release);
+            this->notifyWriter();
+            return true;
+        }
+
+        /**
+         * Block until every frame pushed before this call is written or dropped
+         */
+        void flush();
+
+        /**
+         * @return number of queued frames not yet written
+         */
+        size_t depth() const;
+
+        Statistics statistics() const;
+    };
+}
+
+#endif // SERIAL_SEND_QUEUE_HPP
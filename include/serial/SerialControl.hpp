@@ -8,11 +8,20 @@
 #include <cstdint>
 
 #include <termios.h> /* POSIX terminal control definitions */
+#include <sys/uio.h>  /* Scatter/gather I/O */
 
 namespace serial
 {
     using String = std::string;
 
+    namespace command
+    {
+        template <typename DataType>
+        struct RawCommandFrame;
+    }
+
+    class CaptureWriter;
+
     class SerialClosedException : public std::exception
     {
       public:
@@ -28,12 +37,31 @@ namespace serial
 
       private:
 
-        int fileDescriptor {};
+        std::atomic<int> fileDescriptor { -1 };
+
+        // cleared as soon as a read or write reports a lost device
+        mutable std::atomic_bool connected { false };
+
+        // with VMIN > 0 a blocking read only returns 0 on hang up
+        mutable std::atomic_bool emptyReadIsHangUp { true };
+
+        // every chunk read or written is recorded here if set
+        std::atomic<CaptureWriter*> capture { nullptr };
+
+        /**
+         * Clear the connection state if `error` means the device is gone
+         * @return true if it does
+         */
+        bool lost(int error) const;
 
       public:
 
         SerialControl() = default;
 
+        SerialControl(const SerialControl & another);
+
+        SerialControl & operator=(const SerialControl & another);
+
         explicit SerialControl(const String & tty, int baudRate, int flags = 0x00);
 
         /**
@@ -50,16 +78,39 @@ namespace serial
         bool open(const String & tty, int baudRate, int cflag = CS8 | CLOCAL | CREAD, int iflag = 0, int oflag = 0, int lflag = 0);
 
         /**
-         * Check if the port is open
+         * Check if the port is open, without a syscall: the state is set
+         * by `open` and cleared by `close` or by a read or write that
+         * fails with EIO, EBADF, ENXIO, ENODEV or EPIPE
          * @return
          */
         [[nodiscard]]
-        bool isOpen() const;
+        inline bool isOpen() const
+        {
+            return this->connected.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @return file descriptor of the port, for event loops
+         */
+        [[nodiscard]]
+        inline int getFileDescriptor() const
+        {
+            return this->fileDescriptor;
+        }
+
+        /**
+         * Close the port, does nothing if it is already closed
+         */
+        void close();
 
         /**
-         * Close the port
+         * Record every chunk read or written from now on, null stops.
+         * The writer must outlive any I/O on this port.
          */
-        void close() const;
+        inline void setCapture(CaptureWriter* writer)
+        {
+            this->capture.store(writer, std::memory_order_release);
+        }
 
         /**
          * Set baud rate
@@ -68,6 +119,21 @@ namespace serial
          */
         void setBaudRate(int baud) const;
 
+        /**
+         * Set the raw mode read conditions, see termios(3)
+         * @param vmin minimum number of bytes a blocking read waits for
+         * @param vtime inter-byte timeout in tenths of a second
+         * @return false if the terminal rejected the setting
+         */
+        bool setReadTimeouts(uint8_t vmin, uint8_t vtime) const;
+
+        /**
+         * Ask the driver to push received bytes to the tty layer at once
+         * instead of batching them (ASYNC_LOW_LATENCY)
+         * @return false if the driver does not support it
+         */
+        bool setLowLatency(bool value) const;
+
         /**
          * Add tty flag
          * @param flag
@@ -85,8 +151,9 @@ namespace serial
          * @param data data ptr
          * @param size length of data
          * @return number of successfully sent bytes
+         * @throw SerialClosedException if the port is closed or the write lost it
          */
-        int send(void* data, size_t size) const;
+        int send(const void* data, size_t size) const;
 
         /**
          * Send a data struct to serial port
@@ -95,7 +162,10 @@ namespace serial
          * @return number of successfully sent bytes
          */
         template <typename T>
-        int send(T* data) const;
+        int send(T* data) const
+        {
+            return this->send((const void*) data, sizeof(T));
+        }
 
         /**
          * Send a data struct to serial port
@@ -111,13 +181,37 @@ namespace serial
          * @return number of successfully sent bytes
          */
         template <typename T>
-        int send(const T & data) const;
+        int send(const T & data) const
+        {
+            return this->send((const void*) &data, sizeof(T));
+        }
+
+        /**
+         * Send a packed command frame as is, without an intermediate copy
+         * @tparam DataType frame payload type
+         * @param frame raw frame
+         * @return number of successfully sent bytes
+         */
+        template <typename DataType>
+        int send(const command::RawCommandFrame<DataType> & frame) const
+        {
+            return this->send((const void*) &frame, sizeof(frame));
+        }
+
+        /**
+         * Send several buffers to serial port with a single syscall
+         * @param buffers buffer descriptors
+         * @param count number of buffers
+         * @return number of successfully sent bytes
+         */
+        int send(const struct iovec* buffers, int count) const;
 
         /**
          * Receive bytes from serial port
          * @param data dst ptr
          * @param size length of data
          * @return number of successfully received bytes
+         * @throw SerialClosedException if the port is closed or the read lost it
          */
         int receive(void* data, size_t size) const;
 
@@ -0,0 +1,92 @@
+#ifndef SERIAL_TIMER_WHEEL_HPP
+#define SERIAL_TIMER_WHEEL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace serial
+{
+    /**
+     * Hashed timing wheel: one slot per tick, a timer further away than
+     * one turn waits in its slot for the remaining turns. Scheduling is
+     * O(1) and one thread expires any number of timers. There is no
+     * cancelling, the owner ignores timers whose work already finished.
+     */
+    class TimerWheel
+    {
+      public:
+
+        using Duration = std::chrono::microseconds;
+
+        /**
+         * Called on the wheel's thread with the id of every expired timer
+         */
+        using Expire = std::function<void(uint64_t id)>;
+
+        struct Options
+        {
+            Duration tick = Duration(1000);   // resolution, timers expire up to one tick late
+            size_t slots = 512;
+        };
+
+      private:
+
+        using Clock = std::chrono::steady_clock;
+        using Mutex = std::mutex;
+        using Lock = std::unique_lock<Mutex>;
+
+        struct Timer
+        {
+            uint64_t id;
+            uint64_t turns;           // visits of its slot left before it expires
+        };
+
+        Expire expire;
+        Options options;
+
+        Mutex mutex;
+        std::condition_variable wakeup;
+        std::vector<std::vector<Timer>> slots;
+        Clock::time_point start;
+        uint64_t current = 0;         // last tick handled
+        size_t pending = 0;
+        bool running = true;
+        std::thread wheelThread;
+
+        uint64_t ticksSinceStart(Clock::time_point time) const;
+
+        void wheelDaemon();
+
+      public:
+
+        TimerWheel(Expire expire, const Options & options);
+
+        TimerWheel(const TimerWheel &) = delete;
+
+        TimerWheel & operator=(const TimerWheel &) = delete;
+
+        /**
+         * Stops the thread, timers not expired yet never are
+         */
+        ~TimerWheel();
+
+        /**
+         * Expire `id` after `delay`, rounded up to whole ticks
+         */
+        void schedule(uint64_t id, Duration delay);
+
+        /**
+         * @return timers not expired yet
+         */
+        [[nodiscard]]
+        size_t size();
+    };
+}
+
+#endif // SERIAL_TIMER_WHEEL_HPP
@@ -0,0 +1,91 @@
+#ifndef SERIAL_WRITE_COALESCER_HPP
+#define SERIAL_WRITE_COALESCER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace serial
+{
+    /**
+     * Accumulates encoded frames and hands them to a sink in one write,
+     * either when `maxBytes` are pending or `maxDelay` after the first
+     * pending frame, whichever comes first
+     */
+    class WriteCoalescer
+    {
+      public:
+
+        using byte_t = unsigned char;
+        using Duration = std::chrono::microseconds;
+
+        /**
+         * Writes the given buffers with a single syscall
+         * @return number of bytes written
+         */
+        using Sink = std::function<int(const struct iovec*, int)>;
+
+      private:
+
+        using Clock = std::chrono::steady_clock;
+        using Mutex = std::mutex;
+        using Lock = std::unique_lock<Mutex>;
+
+        Sink sink;
+        size_t maxBytes;
+        Duration maxDelay;
+
+        std::vector<byte_t> buffer;
+        Clock::time_point deadline;
+
+        Mutex mutex;
+        std::condition_variable wakeup;
+        std::thread flushThread;
+        bool running = true;
+
+        int flushLocked(const byte_t* extra = nullptr, size_t extraSize = 0);
+
+        void flushDaemon();
+
+      public:
+
+        WriteCoalescer(Sink sink, size_t maxBytes, Duration maxDelay);
+
+        WriteCoalescer(const WriteCoalescer &) = delete;
+
+        WriteCoalescer & operator=(const WriteCoalescer &) = delete;
+
+        /**
+         * Flushes whatever is pending, dropped if the sink throws, and stops the timer thread
+         */
+        ~WriteCoalescer();
+
+        /**
+         * Queue an encoded frame, flushing first if it would overflow
+         * @param frame encoded frame
+         * @param size frame size in bytes
+         * @return false if the frame had to be written and the write failed
+         */
+        bool append(const void* frame, size_t size);
+
+        /**
+         * Write all pending frames now
+         * @return number of bytes written
+         */
+        int flush();
+
+        /**
+         * @return number of bytes waiting to be written
+         */
+        size_t pending();
+    };
+}
+
+#endif // SERIAL_WRITE_COALESCER_HPP
@@ -1,14 +1,113 @@
-
 #ifndef  CRC_HPP
 #define  CRC_HPP
 
+#include <array>
 #include <cstdint>
 #include <vector>
+#include <type_traits>
+
+#include "CrcFolding.hpp"
 
 namespace serial::command
 {
     typedef unsigned char byte_t;
 
+    namespace CrcUtils
+    {
+        static constexpr uint64_t reflect(uint64_t data, byte_t nbits)
+        {
+            uint64_t reflection = 0;
+            for (byte_t bit = 0; bit < nbits; bit++) {
+                if ((data & 1) == 1) {
+                    reflection |= 1ull << ((nbits - 1) - bit);
+                }
+                data >>= 1;
+            }
+            return reflection;
+        }
+
+        /**
+         * Remainder of `x^n` divided by the full polynomial `x^width + polynomial`
+         */
+        static constexpr uint64_t xPowMod(uint32_t n, byte_t width, uint32_t polynomial)
+        {
+            uint64_t remainder = 1;
+            for (uint32_t i = 0; i < n; i++) {
+                remainder <<= 1;
+                if (remainder & (1ull << width)) {
+                    remainder ^= (1ull << width) | polynomial;
+                }
+            }
+            return remainder;
+        }
+
+        static constexpr unsigned SLICES = 8;
+
+        template <typename Register>
+        using Table = std::array<std::array<Register, 256>, SLICES>;
+
+        /**
+         * Slice tables, `table[k][b]` is the register contribution of byte `b`
+         * followed by `k` zero bytes. With reflected input the tables are
+         * generated for the reflected polynomial, so the register is kept
+         * reflected and no per-byte reflection is needed.
+         */
+        template <typename Register, byte_t width, uint32_t polynomial, bool reflected>
+        constexpr Table<Register> makeTable()
+        {
+            constexpr uint64_t mask = (1ull << width) - 1;
+            Table<Register> table {};
+            for (uint32_t byte = 0; byte < 256; byte++) {
+                uint64_t reg = 0;
+                if constexpr (reflected) {
+                    constexpr uint64_t reflectedPoly = reflect(polynomial, width);
+                    reg = byte;
+                    for (int bit = 0; bit < 8; bit++) {
+                        reg = (reg & 1) ? (reg >> 1) ^ reflectedPoly : reg >> 1;
+                    }
+                } else {
+                    reg = (uint64_t) byte << (width - 8);
+                    for (int bit = 0; bit < 8; bit++) {
+                        reg = (reg & (1ull << (width - 1))) ? (reg << 1) ^ polynomial : reg << 1;
+                    }
+                }
+                table[0][byte] = (Register) (reg & mask);
+            }
+            for (unsigned slice = 1; slice < SLICES; slice++) {
+                for (uint32_t byte = 0; byte < 256; byte++) {
+                    uint64_t prev = table[slice - 1][byte];
+                    if constexpr (reflected) {
+                        table[slice][byte] = (Register) ((prev >> 8) ^ table[0][prev & 0xFF]);
+                    } else {
+                        table[slice][byte] = (Register) (((prev << 8) ^ table[0][(prev >> (width - 8)) & 0xFF]) & mask);
+                    }
+                }
+            }
+            return table;
+        }
+
+        template <typename Register, byte_t width, uint32_t polynomial, bool reflected>
+        inline constexpr Table<Register> table = makeTable<Register, width, polynomial, reflected>();
+
+        static inline uint32_t load32(const byte_t* data, bool bigEndian)
+        {
+            uint32_t word = 0;
+            for (int i = 0; i < 4; i++) {
+                word |= (uint32_t) data[i] << (bigEndian ? 8 * (3 - i) : 8 * i);
+            }
+            return word;
+        }
+
+        static inline uint64_t load64(const byte_t* data, bool bigEndian)
+        {
+            uint64_t word = 0;
+            for (int i = 0; i < 8; i++) {
+                word |= (uint64_t) data[i] << (bigEndian ? 8 * (7 - i) : 8 * i);
+            }
+            return word;
+        }
+    }
+
     template <
         byte_t width, uint32_t polynomial,
         uint32_t initialXOR, uint32_t finalXOR,
@@ -20,9 +119,41 @@ namespace serial::command
 
         CRC() = default;
 
+        /**
+         * Widths below 8 bits keep the original bit-by-bit engine, every
+         * other width is served by the lookup tables below.
+         */
+        static constexpr bool tableDriven = width >= 8 && width <= 32;
+
+        static constexpr uint64_t crcMask = (width < 8) ? (1ull << 8) - 1 : (1ull << width) - 1;
+
+        using Register = std::conditional_t<
+            (width <= 8), uint8_t, std::conditional_t<(width <= 16), uint16_t, uint32_t>
+        >;
+
+        /**
+         * Carry-less multiply folding is only wired up for reflected input,
+         * where the register can be xor-ed straight into the first block
+         */
+        static constexpr bool foldable = tableDriven && doReflectData;
+
+        static constexpr CrcFolding::Constants foldConstants = {
+            CrcUtils::reflect(CrcUtils::xPowMod(128 + 64 - 1, width, polynomial), 64),
+            CrcUtils::reflect(CrcUtils::xPowMod(128 - 1,      width, polynomial), 64),
+            CrcUtils::reflect(CrcUtils::xPowMod(512 + 64 - 1, width, polynomial), 64),
+            CrcUtils::reflect(CrcUtils::xPowMod(512 - 1,      width, polynomial), 64),
+        };
+
+        static constexpr const auto & table = CrcUtils::table<
+            Register, (tableDriven ? width : 8), polynomial, doReflectData
+        >;
+
       public:
 
-        class CrcIterator
+        /**
+         * Reference engine, processes every byte bit by bit.
+         */
+        class BitwiseIterator
         {
           private:
 
@@ -31,14 +162,7 @@ namespace serial::command
             static byte_t reflectByte(byte_t dataByte)
             {
                 if (doReflectData) {
-                    byte_t reflection = 0x0;
-                    for (byte_t bit = 0; bit < 8; bit++) {
-                        if ((dataByte & 1) == 1) {
-                            reflection |= (byte_t) (1 << (7 - bit));
-                        }
-                        dataByte >>= 1;
-                    }
-                    return reflection;
+                    return (byte_t) CrcUtils::reflect(dataByte, 8);
                 }
                 return dataByte;
             }
@@ -46,16 +170,7 @@ namespace serial::command
             static uint64_t reflectRemainder(uint64_t data)
             {
                 if (doReflectRemainder) {
-                    uint64_t reflection = 0;
-                    auto nbits = (byte_t) (width < 8 ? 8 : width);
-
-                    for (byte_t bit = 0; bit < nbits; bit++) {
-                        if ((data & 1) == 1) {
-                            reflection |= 1ul << ((nbits - 1) - bit);
-                        }
-                        data >>= 1;
-                    }
-                    return reflection;
+                    return CrcUtils::reflect(data, (byte_t) (width < 8 ? 8 : width));
                 }
                 return data;
             }
@@ -65,14 +180,9 @@ namespace serial::command
                 return (width < 8) ? 1ul << 7 : 1ul << (width - 1);
             }
 
-            static inline uint64_t getCrcMask()
-            {
-                return (width < 8) ? (1ul << 8) - 1 : (1ul << width) - 1;
-            }
-
           public:
 
-            CrcIterator() = default;
+            BitwiseIterator() = default;
 
             void computeNext(byte_t byte)
             {
@@ -87,7 +197,7 @@ namespace serial::command
                     }
                 } else {
                     byte_t dataByte = reflectByte(byte);
-                    value ^= (uint64_t) (dataByte << (width - 8));
+                    value ^= (uint64_t) dataByte << (width - 8);
                     for (byte_t bit = 8; bit > 0; bit--) {
                         if ((value & getTopBit()) > 0) {
                             value = (value << 1) ^ polynomial;
@@ -98,20 +208,135 @@ namespace serial::command
                 }
             }
 
-            uint64_t getValue()
+            void computeNext(const byte_t* data, size_t length)
             {
-                value &= getCrcMask();
+                for (size_t i = 0; i < length; i++) {
+                    computeNext(data[i]);
+                }
+            }
+
+            [[nodiscard]]
+            uint64_t getValue() const
+            {
+                uint64_t remainder = value & crcMask;
 
                 if (width < 8) {
-                    value = (value << (8 - width));
+                    remainder = (remainder << (8 - width));
+                }
+
+                return (reflectRemainder(remainder) ^ finalXOR) & crcMask;
+            }
+        };
+
+        /**
+         * Table driven engine, one lookup per byte and eight bytes per
+         * step in the bulk `computeNext(data, length)` path. Long reflected
+         * inputs are folded with carry-less multiply when the CPU has it.
+         */
+        class TableIterator
+        {
+          private:
+
+            Register value = doReflectData
+                ? (Register) CrcUtils::reflect(initialXOR & crcMask, width)
+                : (Register) (initialXOR & crcMask);
+
+          public:
+
+            TableIterator() = default;
+
+            inline void computeNext(byte_t byte)
+            {
+                if constexpr (doReflectData) {
+                    value = (Register) ((value >> 8) ^ table[0][(value ^ byte) & 0xFF]);
+                } else {
+                    value = (Register) (((value << 8) ^ table[0][((value >> (width - 8)) ^ byte) & 0xFF]) & crcMask);
+                }
+            }
+
+            void computeNext(const byte_t* data, size_t length)
+            {
+                if constexpr (foldable) {
+                    if (length >= CrcFolding::MIN_LENGTH && CrcFolding::available) {
+                        computeFolded(data, length);
+                        return;
+                    }
+                }
+                computeSliced(data, length);
+            }
+
+            void computeFolded(const byte_t* data, size_t length)
+            {
+                static_assert(foldable, "folding requires reflected input");
+                size_t blocks = length / CrcFolding::BLOCK_SIZE;
+                if (blocks > 0) {
+                    byte_t residue[CrcFolding::BLOCK_SIZE];
+                    CrcFolding::fold(foldConstants, value, data, blocks, residue);
+                    value = 0;
+                    computeSliced(residue, CrcFolding::BLOCK_SIZE);
+                    data   += blocks * CrcFolding::BLOCK_SIZE;
+                    length -= blocks * CrcFolding::BLOCK_SIZE;
                 }
+                computeSliced(data, length);
+            }
 
-                value = (reflectRemainder(value) ^ finalXOR) & getCrcMask();
-                return value;
+            void computeSliced(const byte_t* data, size_t length)
+            {
+                for (; length >= 8; data += 8, length -= 8) {
+                    if constexpr (doReflectData) {
+                        uint64_t word = CrcUtils::load64(data, false) ^ value;
+                        value = (Register) (
+                            table[7][word & 0xFF]         ^ table[6][(word >> 8) & 0xFF]  ^
+                            table[5][(word >> 16) & 0xFF] ^ table[4][(word >> 24) & 0xFF] ^
+                            table[3][(word >> 32) & 0xFF] ^ table[2][(word >> 40) & 0xFF] ^
+                            table[1][(word >> 48) & 0xFF] ^ table[0][word >> 56]
+                        );
+                    } else {
+                        uint64_t word = CrcUtils::load64(data, true) ^ ((uint64_t) value << (64 - width));
+                        value = (Register) (
+                            table[7][word >> 56]          ^ table[6][(word >> 48) & 0xFF] ^
+                            table[5][(word >> 40) & 0xFF] ^ table[4][(word >> 32) & 0xFF] ^
+                            table[3][(word >> 24) & 0xFF] ^ table[2][(word >> 16) & 0xFF] ^
+                            table[1][(word >> 8) & 0xFF]  ^ table[0][word & 0xFF]
+                        );
+                    }
+                }
+                if (length >= 4) {
+                    if constexpr (doReflectData) {
+                        uint32_t word = CrcUtils::load32(data, false) ^ value;
+                        value = (Register) (
+                            table[3][word & 0xFF]         ^ table[2][(word >> 8) & 0xFF] ^
+                            table[1][(word >> 16) & 0xFF] ^ table[0][word >> 24]
+                        );
+                    } else {
+                        uint32_t word = CrcUtils::load32(data, true) ^ ((uint32_t) value << (32 - width));
+                        value = (Register) (
+                            table[3][word >> 24]          ^ table[2][(word >> 16) & 0xFF] ^
+                            table[1][(word >> 8) & 0xFF]  ^ table[0][word & 0xFF]
+                        );
+                    }
+                    data += 4;
+                    length -= 4;
+                }
+                for (; length > 0; data++, length--) {
+                    computeNext(*data);
+                }
             }
 
+            [[nodiscard]]
+            uint64_t getValue() const
+            {
+                uint64_t remainder = value;
+                // the register is already reflected when the input is
+                if (doReflectData != doReflectRemainder) {
+                    remainder = CrcUtils::reflect(remainder, width);
+                }
+                return (remainder ^ finalXOR) & crcMask;
+            }
         };
 
+        using CrcIterator = std::conditional_t<tableDriven, TableIterator, BitwiseIterator>;
+
         static CrcIterator iterator()
         {
             return CrcIterator();
@@ -120,9 +345,7 @@ namespace serial::command
         static uint64_t compute(const byte_t* data, size_t length)
         {
             CrcIterator iterator;
-            for (size_t i = 0; i < length; i++) {
-                iterator.computeNext(data[i]);
-            }
+            iterator.computeNext(data, length);
             return iterator.getValue();
         }
 
@@ -130,6 +353,33 @@ namespace serial::command
         {
             return compute(bytes.data(), bytes.size());
         }
+
+        /**
+         * Slice-by-8 tables only, bypassing the carry-less multiply path
+         */
+        static uint64_t computeTable(const byte_t* data, size_t length)
+        {
+            TableIterator iterator;
+            iterator.computeSliced(data, length);
+            return iterator.getValue();
+        }
+
+        /**
+         * Carry-less multiply folding, the caller must check `CrcFolding::available`
+         */
+        static uint64_t computeFolded(const byte_t* data, size_t length)
+        {
+            TableIterator iterator;
+            iterator.computeFolded(data, length);
+            return iterator.getValue();
+        }
+
+        static uint64_t computeBitwise(const byte_t* data, size_t length)
+        {
+            BitwiseIterator iterator;
+            iterator.computeNext(data, length);
+            return iterator.getValue();
+        }
     };
 
     template <
@@ -153,4 +403,4 @@ namespace serial::command
     >;
 
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,68 @@
+#ifndef SERIAL_COBS_HPP
+#define SERIAL_COBS_HPP
+
+#include "CommandFrame.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/uio.h>
+
+namespace serial::command
+{
+    /**
+     * Framing of the byte stream
+     *
+     *   SOF   frames start with the SOF byte, which may also occur inside
+     *         a frame, a receiver out of sync tries every SOF it finds
+     *   COBS  every frame is COBS encoded, so it holds no 0x00 byte, and
+     *         followed by a 0x00 delimiter. A receiver finds the next
+     *         frame boundary with one `memchr` and resyncs at once.
+     *
+     * The frame inside the COBS encoding is the same as with SOF framing.
+     */
+    enum class Framing : uint8_t
+    {
+        SOF,
+        COBS,
+    };
+
+    /**
+     * Consistent Overhead Byte Stuffing. Runs of non-zero bytes are
+     * found with `memchr` and moved with `memcpy`, a byte at a time is
+     * only touched for the code bytes.
+     */
+    namespace Cobs
+    {
+        constexpr byte_t DELIMITER = 0x00;
+
+        /**
+         * @return encoded size of `size` bytes in the worst case, delimiter excluded
+         */
+        constexpr size_t maxEncodedSize(size_t size)
+        {
+            return size + size / 254 + 1;
+        }
+
+        /**
+         * Encode `size` bytes, no delimiter is appended
+         * @param output room for `maxEncodedSize(size)` bytes
+         * @return encoded size
+         */
+        size_t encode(const byte_t* data, size_t size, byte_t* output);
+
+        /**
+         * Encode the concatenation of `count` buffers
+         */
+        size_t encode(const struct iovec* buffers, int count, byte_t* output);
+
+        /**
+         * Decode one frame, `data` is what came before its delimiter
+         * @param output room for `size` bytes
+         * @return decoded size, `SIZE_MAX` if `data` is not valid COBS
+         */
+        size_t decode(const byte_t* data, size_t size, byte_t* output);
+    }
+}
+
+#endif // SERIAL_COBS_HPP
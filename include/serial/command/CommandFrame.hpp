@@ -2,10 +2,15 @@
 
 #include "CRC.hpp"
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <functional>
 #include <cstdint>
+#include <cstring>
+
+#include <sys/uio.h>
 
 #if __cplusplus >= 201703L
   #include <optional>
@@ -49,7 +54,9 @@
     {
         using Crc8  = CRC8<0x31,    0xFF,   0x00>;
         using Crc16 = CRC16<0x1021, 0xFFFF, 0x0000>;
-        static byte_t sequence;
+
+        // numbers frames built without a sequence number of their own, one counter for the program
+        inline std::atomic<byte_t> sequence;
     }
 
     template <typename DataType>
@@ -79,11 +86,16 @@
       public:
 
         explicit CommandFrame(int commandId, const DataType & data, byte_t sof = 0xA5)
+            : CommandFrame(commandId, data, sof, CommandFrameUtils::sequence.fetch_add(1, std::memory_order_relaxed))
+        {
+        }
+
+        CommandFrame(int commandId, const DataType & data, byte_t sof, byte_t sequence)
         {
             this->sof = sof;
             this->rawFrame.sof = sof;
             this->rawFrame.dataLength = sizeof(data);
-            this->rawFrame.sequence = CommandFrameUtils::sequence++;
+            this->rawFrame.sequence = sequence;
             this->rawFrame.crc8Value = crc8();
             this->rawFrame.commandId = commandId;
             this->rawFrame.data = data;
@@ -144,6 +156,11 @@
             return rawFrame;
         }
 
+        const RawCommandFrame<DataType> & getRawFrame() const
+        {
+            return rawFrame;
+        }
+
         [[nodiscard]]
         bool validate() const
         {
@@ -177,14 +194,116 @@
             }
         }
 
+        /**
+         * Encode the frame into a caller provided buffer
+         * @param buffer destination
+         * @param capacity size of the destination in bytes
+         * @return number of bytes written, 0 if the buffer is too small
+         */
+        size_t encode(byte_t* buffer, size_t capacity) const
+        {
+            if (capacity < frameSize()) {
+                return 0;
+            }
+            std::memcpy(buffer, &rawFrame, frameSize());
+            return frameSize();
+        }
+
         [[nodiscard]]
         std::vector<byte_t> toBytes() const
         {
-            std::vector<byte_t> bytes(sizeof(RawFrame));
-            const auto* ptr = reinterpret_cast<const byte_t*>(&rawFrame);
-            for (size_t i = 0; i < bytes.size(); i++, ptr++) {
-                bytes[i] = *ptr;
+            std::vector<byte_t> bytes(frameSize());
+            this->encode(bytes.data(), bytes.size());
+            return bytes;
+        }
+    };
+
+    /**
+     * A frame whose DATA is only as long as the payload given, up to
+     * 65535 bytes. Header and CRC16 are built here, the payload is not
+     * copied and must outlive the frame.
+     */
+    class DynamicCommandFrame
+    {
+      public:
+
+        static constexpr size_t HEADER_SIZE = 7;
+        static constexpr size_t TRAILER_SIZE = 2;
+        static constexpr size_t MAX_DATA_SIZE = UINT16_MAX;
+
+      private:
+
+        std::array<byte_t, HEADER_SIZE> header {};
+        std::array<byte_t, TRAILER_SIZE> trailer {};
+        const byte_t* data;
+        uint16_t dataLength;
+
+      public:
+
+        /**
+         * @param length payload bytes, at most `MAX_DATA_SIZE`
+         */
+        DynamicCommandFrame(int commandId, const void* data, size_t length, byte_t sof = 0xA5)
+            : DynamicCommandFrame(commandId, data, length, sof, CommandFrameUtils::sequence.fetch_add(1, std::memory_order_relaxed))
+        {
+        }
+
+        DynamicCommandFrame(int commandId, const void* data, size_t length, byte_t sof, byte_t sequence)
+            : data(static_cast<const byte_t*>(data)), dataLength((uint16_t) length)
+        {
+            this->header[0] = sof;
+            this->header[1] = (byte_t) (this->dataLength & 0xFF);
+            this->header[2] = (byte_t) (this->dataLength >> 8);
+            this->header[3] = sequence;
+            this->header[4] = (byte_t) CommandFrameUtils::Crc8::compute(this->header.data(), 4);
+            this->header[5] = (byte_t) (commandId & 0xFF);
+            this->header[6] = (byte_t) ((commandId >> 8) & 0xFF);
+
+            auto crc = CommandFrameUtils::Crc16::iterator();
+            crc.computeNext(this->header.data(), HEADER_SIZE);
+            crc.computeNext(this->data, this->dataLength);
+            auto crc16 = (uint16_t) crc.getValue();
+            this->trailer[0] = (byte_t) (crc16 & 0xFF);
+            this->trailer[1] = (byte_t) (crc16 >> 8);
+        }
+
+        [[nodiscard]]
+        size_t frameSize() const
+        {
+            return HEADER_SIZE + this->dataLength + TRAILER_SIZE;
+        }
+
+        /**
+         * Header, payload and CRC16 for a single `writev`
+         */
+        void buffers(struct iovec (& buffers)[3]) const
+        {
+            buffers[0] = { const_cast<byte_t*>(this->header.data()), HEADER_SIZE };
+            buffers[1] = { const_cast<byte_t*>(this->data), this->dataLength };
+            buffers[2] = { const_cast<byte_t*>(this->trailer.data()), TRAILER_SIZE };
+        }
+
+        /**
+         * @return number of bytes written, 0 if the buffer is too small
+         */
+        size_t encode(byte_t* buffer, size_t capacity) const
+        {
+            if (capacity < this->frameSize()) {
+                return 0;
+            }
+            std::memcpy(buffer, this->header.data(), HEADER_SIZE);
+            if (this->dataLength > 0) {
+                std::memcpy(buffer + HEADER_SIZE, this->data, this->dataLength);
             }
+            std::memcpy(buffer + HEADER_SIZE + this->dataLength, this->trailer.data(), TRAILER_SIZE);
+            return this->frameSize();
+        }
+
+        [[nodiscard]]
+        std::vector<byte_t> toBytes() const
+        {
+            std::vector<byte_t> bytes(this->frameSize());
+            this->encode(bytes.data(), bytes.size());
             return bytes;
         }
     };
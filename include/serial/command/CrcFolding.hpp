@@ -0,0 +1,182 @@
+#ifndef CRC_FOLDING_HPP
+#define CRC_FOLDING_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #define CRC_FOLDING_CLMUL
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)) && defined(__linux__)
+  #include <arm_neon.h>
+  #include <sys/auxv.h>
+  #include <asm/hwcap.h>
+  #define CRC_FOLDING_PMULL
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+|  Carry-less multiply folding for reflected CRCs, see Intel's "Fast CRC Computation for    |
+|  Generic Polynomials Using PCLMULQDQ Instruction". A 16-byte block A followed by block B   |
+|  is replaced by A_hi * (x^191 mod P) + A_lo * (x^127 mod P) + B, which is congruent to     |
+|  A * x^128 + B. The remaining 16-byte residue and the tail go through the table engine.   |
+\* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+namespace serial::command::CrcFolding
+{
+    typedef unsigned char byte_t;
+
+    /**
+     * Bit-reflected `x^n mod P` constants, `fold1` moves a block 128 bits
+     * forward and `fold4` moves it 512 bits forward
+     */
+    struct Constants
+    {
+        uint64_t fold1Low, fold1High;
+        uint64_t fold4Low, fold4High;
+    };
+
+    /**
+     * Minimum number of bytes for which folding beats the slice tables
+     */
+    static constexpr size_t MIN_LENGTH = 64;
+
+    static constexpr size_t BLOCK_SIZE = 16;
+
+  #if defined(CRC_FOLDING_CLMUL)
+
+    #define CRC_FOLDING_TARGET __attribute__((target("pclmul,sse2")))
+
+    CRC_FOLDING_TARGET
+    static inline __m128i foldBlock(__m128i block, __m128i constants, __m128i next)
+    {
+        __m128i low  = _mm_clmulepi64_si128(block, constants, 0x00);
+        __m128i high = _mm_clmulepi64_si128(block, constants, 0x11);
+        return _mm_xor_si128(_mm_xor_si128(low, high), next);
+    }
+
+    CRC_FOLDING_TARGET
+    static inline __m128i loadBlock(const byte_t* data)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+
+    /**
+     * Fold `blocks` 16-byte blocks into a single congruent block
+     * @param constants folding constants of the polynomial
+     * @param initial reflected register, xor-ed into the first bytes
+     * @param data at least `blocks * 16` bytes
+     * @param blocks number of blocks, at least one
+     * @param output 16-byte residue
+     */
+    CRC_FOLDING_TARGET
+    static inline void fold(const Constants & constants, uint64_t initial, const byte_t* data, size_t blocks, byte_t* output)
+    {
+        const __m128i fold1 = _mm_set_epi64x((long long) constants.fold1High, (long long) constants.fold1Low);
+        const __m128i fold4 = _mm_set_epi64x((long long) constants.fold4High, (long long) constants.fold4Low);
+
+        __m128i x0 = _mm_xor_si128(loadBlock(data), _mm_set_epi64x(0, (long long) initial));
+        size_t block = 1;
+
+        if (blocks >= 4) {
+            __m128i x1 = loadBlock(data + 1 * BLOCK_SIZE);
+            __m128i x2 = loadBlock(data + 2 * BLOCK_SIZE);
+            __m128i x3 = loadBlock(data + 3 * BLOCK_SIZE);
+            for (block = 4; block + 4 <= blocks; block += 4) {
+                const byte_t* next = data + block * BLOCK_SIZE;
+                x0 = foldBlock(x0, fold4, loadBlock(next + 0 * BLOCK_SIZE));
+                x1 = foldBlock(x1, fold4, loadBlock(next + 1 * BLOCK_SIZE));
+                x2 = foldBlock(x2, fold4, loadBlock(next + 2 * BLOCK_SIZE));
+                x3 = foldBlock(x3, fold4, loadBlock(next + 3 * BLOCK_SIZE));
+            }
+            x0 = foldBlock(x0, fold1, x1);
+            x0 = foldBlock(x0, fold1, x2);
+            x0 = foldBlock(x0, fold1, x3);
+        }
+
+        for (; block < blocks; block++) {
+            x0 = foldBlock(x0, fold1, loadBlock(data + block * BLOCK_SIZE));
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output), x0);
+    }
+
+    #undef CRC_FOLDING_TARGET
+
+    static inline bool detect()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2");
+    }
+
+  #elif defined(CRC_FOLDING_PMULL)
+
+    static inline uint64x2_t foldBlock(uint64x2_t block, poly64_t low, poly64_t high, uint64x2_t next)
+    {
+        poly128_t lowProduct  = vmull_p64((poly64_t) vgetq_lane_u64(block, 0), low);
+        poly128_t highProduct = vmull_p64((poly64_t) vgetq_lane_u64(block, 1), high);
+        return veorq_u64(
+            veorq_u64(vreinterpretq_u64_p128(lowProduct), vreinterpretq_u64_p128(highProduct)), next
+        );
+    }
+
+    static inline uint64x2_t loadBlock(const byte_t* data)
+    {
+        return vreinterpretq_u64_u8(vld1q_u8(data));
+    }
+
+    static inline void fold(const Constants & constants, uint64_t initial, const byte_t* data, size_t blocks, byte_t* output)
+    {
+        const auto fold1Low  = (poly64_t) constants.fold1Low;
+        const auto fold1High = (poly64_t) constants.fold1High;
+        const auto fold4Low  = (poly64_t) constants.fold4Low;
+        const auto fold4High = (poly64_t) constants.fold4High;
+
+        uint64x2_t x0 = veorq_u64(loadBlock(data), vcombine_u64(vcreate_u64(initial), vcreate_u64(0)));
+        size_t block = 1;
+
+        if (blocks >= 4) {
+            uint64x2_t x1 = loadBlock(data + 1 * BLOCK_SIZE);
+            uint64x2_t x2 = loadBlock(data + 2 * BLOCK_SIZE);
+            uint64x2_t x3 = loadBlock(data + 3 * BLOCK_SIZE);
+            for (block = 4; block + 4 <= blocks; block += 4) {
+                const byte_t* next = data + block * BLOCK_SIZE;
+                x0 = foldBlock(x0, fold4Low, fold4High, loadBlock(next + 0 * BLOCK_SIZE));
+                x1 = foldBlock(x1, fold4Low, fold4High, loadBlock(next + 1 * BLOCK_SIZE));
+                x2 = foldBlock(x2, fold4Low, fold4High, loadBlock(next + 2 * BLOCK_SIZE));
+                x3 = foldBlock(x3, fold4Low, fold4High, loadBlock(next + 3 * BLOCK_SIZE));
+            }
+            x0 = foldBlock(x0, fold1Low, fold1High, x1);
+            x0 = foldBlock(x0, fold1Low, fold1High, x2);
+            x0 = foldBlock(x0, fold1Low, fold1High, x3);
+        }
+
+        for (; block < blocks; block++) {
+            x0 = foldBlock(x0, fold1Low, fold1High, loadBlock(data + block * BLOCK_SIZE));
+        }
+
+        vst1q_u8(output, vreinterpretq_u8_u64(x0));
+    }
+
+    static inline bool detect()
+    {
+        return (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+    }
+
+  #else
+
+    static inline void fold(const Constants &, uint64_t, const byte_t*, size_t, byte_t*) {}
+
+    static inline bool detect()
+    {
+        return false;
+    }
+
+  #endif
+
+    /**
+     * Whether the running CPU supports carry-less multiply, resolved once
+     */
+    inline const bool available = detect();
+}
+
+#endif // CRC_FOLDING_HPP
@@ -0,0 +1,130 @@
+#ifndef SERIAL_DELTA_CODEC_HPP
+#define SERIAL_DELTA_CODEC_HPP
+
+#include "CommandFrame.hpp"
+#include "Span.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace serial::command
+{
+    /**
+     * Delta mode payloads of a command whose values are `size` bytes:
+     *
+     *   keyframe  the value itself, DLEN = size, so it is exactly what a
+     *             publisher without delta mode sends
+     *   delta     a counter byte, the CRC8 of the keyframe it builds on
+     *             and XOR runs against the previous value, DLEN < size,
+     *             only sent when it is that short
+     *
+     * A run is a skip byte (unchanged bytes before it), a count byte and
+     * `count` bytes XORed into the value, trailing unchanged bytes are
+     * left out. The counter restarts at 0 with every keyframe and grows
+     * by one per delta. A receiver that missed a frame sees a counter or
+     * keyframe CRC it does not expect and ignores deltas until the next
+     * keyframe.
+     */
+    struct DeltaOptions
+    {
+        uint32_t keyframeInterval = 50;    // deltas between two keyframes
+        std::chrono::milliseconds keyframePeriod { 1000 };   // and at most this long apart
+    };
+
+    class DeltaEncoder
+    {
+      private:
+
+        using Clock = std::chrono::steady_clock;
+
+        DeltaOptions options;
+        std::vector<byte_t> last;
+        std::vector<byte_t> delta;
+        bool hasLast = false;
+        bool keyframe = false;
+        uint8_t counter = 0;
+        uint8_t keyframeCrc = 0;
+        uint32_t deltas = 0;
+        Clock::time_point lastKeyframe;
+
+        /**
+         * XOR runs of `value` against `last` after the delta header
+         * @return false as soon as they are not shorter than a keyframe
+         */
+        bool encodeRuns(const byte_t* value);
+
+      public:
+
+        /** counter and keyframe CRC, a delta is always longer */
+        static constexpr size_t HEADER_SIZE = 2;
+
+        DeltaEncoder(size_t size, const DeltaOptions & options);
+
+        /**
+         * Encode the next value, which becomes the base of the next delta
+         * @return the payload to send, valid until the next call
+         */
+        Span<byte_t> encode(const byte_t* value);
+
+        /**
+         * @return whether the last `encode` produced a keyframe
+         */
+        [[nodiscard]]
+        inline bool wasKeyframe() const
+        {
+            return this->keyframe;
+        }
+
+        /**
+         * Send a keyframe next
+         */
+        inline void restart()
+        {
+            this->hasLast = false;
+        }
+    };
+
+    class DeltaDecoder
+    {
+      private:
+
+        std::vector<byte_t> current;
+        bool valid = false;
+        uint8_t counter = 0;
+        uint8_t keyframeCrc = 0;
+
+      public:
+
+        enum class Result
+        {
+            KEYFRAME,
+            DELTA,
+            STALE,        // a delta without the value it applies to, dropped
+            MALFORMED,    // runs past the end of the value, dropped
+        };
+
+        explicit DeltaDecoder(size_t size);
+
+        /**
+         * Apply a received payload, on `KEYFRAME` and `DELTA` the new
+         * value is in `value()`
+         */
+        Result decode(const byte_t* payload, size_t length);
+
+        [[nodiscard]]
+        inline const byte_t* value() const
+        {
+            return this->current.data();
+        }
+
+        [[nodiscard]]
+        inline size_t size() const
+        {
+            return this->current.size();
+        }
+    };
+}
+
+#endif // SERIAL_DELTA_CODEC_HPP
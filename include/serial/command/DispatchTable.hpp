@@ -0,0 +1,149 @@
+#ifndef SERIAL_DISPATCH_TABLE_HPP
+#define SERIAL_DISPATCH_TABLE_HPP
+
+#include "FrameDecoder.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace serial::command
+{
+    /**
+     * Subscriber lookup keyed by the 16-bit command id, split into 256
+     * pages of 256 entries indexed by the high and the low byte. Pages
+     * are allocated on first use, unused ones all point at one shared
+     * empty page, so a lookup is always two indexed loads and no branch
+     * on the way. Entries are filled before receiving starts.
+     */
+    class DispatchTable
+    {
+      public:
+
+        using Invoker = void (*)(void* target, const FrameView & frame);
+
+        struct Entry
+        {
+            Invoker invoke = nullptr;
+            void* target = nullptr;
+            uint16_t dataLength = 0;
+            uint16_t maxDataLength = UINT16_MAX;
+            uint16_t stride = 1;   // DATA must be a whole number of elements of this size
+        };
+
+      private:
+
+        static constexpr size_t PAGE_SIZE = 256;
+
+        using Page = std::array<Entry, PAGE_SIZE>;
+
+        static Page emptyPage;  // never written
+
+        std::array<Page*, PAGE_SIZE> pages;
+        std::vector<std::unique_ptr<Page>> allocated;
+
+      public:
+
+        DispatchTable();
+
+        DispatchTable(const DispatchTable &) = delete;
+
+        DispatchTable & operator=(const DispatchTable &) = delete;
+
+        /**
+         * @param dataLength minimum DATA length a frame needs to reach `invoke`
+         * @param maxDataLength longer frames are dropped
+         * @param stride DATA length must be a multiple of it
+         */
+        void set(uint16_t commandId, Invoker invoke, void* target, uint16_t dataLength,
+                 uint16_t maxDataLength = UINT16_MAX, uint16_t stride = 1);
+
+        void erase(uint16_t commandId);
+
+        /**
+         * @return entry for the id, its `invoke` is null if nobody subscribed
+         */
+        inline const Entry & find(uint16_t commandId) const
+        {
+            return (*this->pages[commandId >> 8])[commandId & 0xFF];
+        }
+    };
+
+    enum class RouteResult : uint8_t
+    {
+        UNROUTED,         // no route takes the command id
+        DELIVERED,
+        TOO_SHORT,        // taken but shorter than the route's type, not delivered
+    };
+
+    /**
+     * A subscription fixed at compile time, `Callback` is called directly
+     * and can be inlined into the dispatcher
+     */
+    template <uint16_t Cmd, typename CmdData, void (*Callback)(const CmdData &)>
+    struct Route
+    {
+        static constexpr uint16_t commandId = Cmd;
+
+        static inline void invoke(const FrameView & frame)
+        {
+            Callback(*reinterpret_cast<const CmdData*>(frame.data));
+        }
+
+        static constexpr size_t dataLength = sizeof(CmdData);
+    };
+
+    /**
+     * Compile-time subscriber registry, `dispatch` compares the id against
+     * constants and calls the matching callback directly, with no table
+     * load, no `std::function` and every callback inlined.
+     *
+     *     using Routes = command::Routes<
+     *         Route<CMD_POS, Vec2f, onPosition>,
+     *         Route<CMD_VEL, Vec2f, onVelocity>>;
+     *     comm.route<Routes>();
+     */
+    template <typename... Route>
+    struct Routes
+    {
+      private:
+
+        static constexpr bool unique()
+        {
+            uint16_t ids[] = { Route::commandId..., 0 };
+            for (size_t i = 0; i < sizeof...(Route); i++) {
+                for (size_t j = i + 1; j < sizeof...(Route); j++) {
+                    if (ids[i] == ids[j]) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        static_assert(unique(), "every command id may be routed only once");
+
+        template <typename R>
+        static inline RouteResult accept(const FrameView & frame)
+        {
+            if (frame.dataLength < R::dataLength) {
+                return RouteResult::TOO_SHORT;
+            }
+            R::invoke(frame);
+            return RouteResult::DELIVERED;
+        }
+
+      public:
+
+        static RouteResult dispatch(const FrameView & frame)
+        {
+            RouteResult result = RouteResult::UNROUTED;
+            (void) ((frame.commandId == Route::commandId && (result = accept<Route>(frame), true)) || ...);
+            return result;
+        }
+    };
+}
+
+#endif // SERIAL_DISPATCH_TABLE_HPP
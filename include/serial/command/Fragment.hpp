@@ -0,0 +1,57 @@
+#ifndef SERIAL_FRAGMENT_HPP
+#define SERIAL_FRAGMENT_HPP
+
+#include "CommandFrame.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace serial::command
+{
+    /**
+     * A frame with command id `COMMAND` carries one piece of a payload
+     * too long to be sent in one go: the original command id, the
+     * offset of the piece and the length of the whole payload, all
+     * little endian, then the bytes. Pieces of one payload are sent in
+     * order and the receiver dispatches the payload once it is whole.
+     */
+    namespace Fragment
+    {
+        constexpr uint16_t COMMAND = 0xFFFE;   // reserved, never dispatched itself
+        constexpr size_t HEADER_SIZE = 6;
+
+        struct Header
+        {
+            uint16_t commandId;
+            uint16_t offset;
+            uint16_t total;
+        };
+
+        inline void writeHeader(byte_t* output, const Header & header)
+        {
+            output[0] = (byte_t) (header.commandId & 0xFF);
+            output[1] = (byte_t) (header.commandId >> 8);
+            output[2] = (byte_t) (header.offset & 0xFF);
+            output[3] = (byte_t) (header.offset >> 8);
+            output[4] = (byte_t) (header.total & 0xFF);
+            output[5] = (byte_t) (header.total >> 8);
+        }
+
+        /**
+         * @return false if the DATA is shorter than the header or the
+         *     piece runs past the end of the payload
+         */
+        inline bool readHeader(const byte_t* data, size_t length, Header & header)
+        {
+            if (length < HEADER_SIZE) {
+                return false;
+            }
+            header.commandId = (uint16_t) (data[0] | data[1] << 8);
+            header.offset = (uint16_t) (data[2] | data[3] << 8);
+            header.total = (uint16_t) (data[4] | data[5] << 8);
+            return (size_t) header.offset + (length - HEADER_SIZE) <= header.total;
+        }
+    }
+}
+
+#endif // SERIAL_FRAGMENT_HPP
@@ -0,0 +1,206 @@
+#ifndef SERIAL_FRAME_DECODER_HPP
+#define SERIAL_FRAME_DECODER_HPP
+
+#include "Cobs.hpp"
+#include "CommandFrame.hpp"
+#include "FramePool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace serial::command
+{
+    /**
+     * A decoded frame, only valid until the next call to `feed` or `next`.
+     * With a pool, `data` is the payload inside `buffer`, copy `*buffer`
+     * to keep the frame. Without one, `data` points into the fed span or
+     * the carry buffer and may be unaligned.
+     */
+    struct FrameView
+    {
+        uint16_t commandId;
+        uint8_t sequence;
+        uint16_t dataLength;
+        const byte_t* data;
+        const FrameBuffer* buffer;
+    };
+
+    /**
+     * Bulk decoder for the SOF/DLEN/SEQ/CRC8/CMD/DATA/CRC16 framing.
+     *
+     * Frames that lie entirely inside a fed span are decoded in place,
+     * only a frame cut by the end of a span is copied into the carry
+     * buffer. SOF is located with `memchr`, both CRCs are computed over
+     * whole ranges, and a failed check resumes the search at the byte
+     * after the rejected SOF so a frame hidden behind a false start is
+     * not lost. With COBS framing frames are cut at each 0x00 found
+     * with `memchr` and decoded before the same checks, a frame that
+     * fails them costs nothing beyond its own bytes. Needs neither
+     * threads nor a tty.
+     *
+     *     decoder.feed(buffer, received);
+     *     FrameView frame;
+     *     while (decoder.next(frame)) {
+     *         dispatch(frame);
+     *     }
+     */
+    class FrameDecoder
+    {
+      public:
+
+        static constexpr size_t HEADER_SIZE = 7;
+        static constexpr size_t TRAILER_SIZE = 2;
+
+        struct Statistics
+        {
+            uint64_t frames;
+            uint64_t crc8Failures;
+            uint64_t crc16Failures;
+            uint64_t oversizedFrames;
+            uint64_t bytesDiscarded;
+            uint64_t resyncs;         // times sync was lost and the decoder searched for SOF
+        };
+
+      private:
+
+        byte_t sof;
+        size_t maxDataLength;
+
+        const byte_t* input = nullptr;
+        size_t inputSize = 0;
+
+        std::vector<byte_t> carry;
+        size_t carryConsumed = 0;
+
+        FramePool* pool;
+        FrameBuffer current;
+
+        Statistics statistics {};
+        bool synced = true;
+
+        Framing framing = Framing::SOF;
+        std::vector<byte_t> decoded;   // the COBS frame being checked
+        bool overflowed = false;       // COBS bytes are skipped up to the next delimiter
+
+        /**
+         * Next frame of a COBS encoded stream
+         */
+        bool nextCobs(FrameView & frame);
+
+        /**
+         * Decode and check the bytes before a delimiter
+         */
+        bool acceptCobs(const byte_t* encoded, size_t size, FrameView & frame);
+
+        bool nextFromInput(FrameView & frame);
+
+        bool nextFromCarry(FrameView & frame);
+
+        /**
+         * Move up to `wanted` bytes of the current span into the carry buffer
+         */
+        void takeInput(size_t wanted);
+
+        /**
+         * Discard carried bytes before the first SOF at or after `from`
+         */
+        void dropCarryToSof(size_t from);
+
+        /**
+         * Check CRC8 and DLEN of a complete header, counting failures
+         */
+        bool headerValid(const byte_t* header);
+
+        /**
+         * Count `count` bytes that belong to no frame
+         */
+        void discard(size_t count);
+
+        void fillView(const byte_t* frameStart, FrameView & frame);
+
+        static size_t frameSize(const byte_t* header);
+
+      public:
+
+        /**
+         * @param sof start of frame byte
+         * @param maxDataLength longer DLEN values are treated as corruption
+         * @param pool if set, every payload is copied once into an aligned
+         *             pooled buffer that subscribers may keep
+         */
+        explicit FrameDecoder(byte_t sof = 0xA5, size_t maxDataLength = UINT16_MAX, FramePool* pool = nullptr);
+
+        /**
+         * Provide the next span of the byte stream, anything left of the
+         * previous span that did not form a frame is kept in the carry buffer
+         */
+        void feed(const byte_t* data, size_t size);
+
+        /**
+         * Decode the next complete frame
+         * @return false once the fed data holds no further complete frame
+         */
+        bool next(FrameView & frame);
+
+        /**
+         * Feed a span and call `handler(const FrameView &)` for every frame in it
+         * @return number of frames decoded
+         */
+        template <typename Handler>
+        size_t decode(const byte_t* data, size_t size, Handler && handler)
+        {
+            size_t count = 0;
+            FrameView frame {};
+            this->feed(data, size);
+            while (this->next(frame)) {
+                handler(frame);
+                count++;
+            }
+            return count;
+        }
+
+        /**
+         * Drop any partially received frame
+         */
+        void reset();
+
+        inline void setSof(byte_t value)
+        {
+            this->sof = value;
+        }
+
+        /**
+         * Switch the framing, dropping any partially received frame
+         */
+        inline void setFraming(Framing value)
+        {
+            this->framing = value;
+            this->reset();
+        }
+
+        [[nodiscard]]
+        inline Framing getFraming() const
+        {
+            return this->framing;
+        }
+
+        inline void setMaxDataLength(size_t length)
+        {
+            this->maxDataLength = length;
+        }
+
+        inline void setPool(FramePool* value)
+        {
+            this->pool = value;
+        }
+
+        [[nodiscard]]
+        inline const Statistics & getStatistics() const
+        {
+            return this->statistics;
+        }
+    };
+}
+
+#endif // SERIAL_FRAME_DECODER_HPP
@@ -0,0 +1,247 @@
+#ifndef SERIAL_FRAME_POOL_HPP
+#define SERIAL_FRAME_POOL_HPP
+
+#include "CommandFrame.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace serial::command
+{
+    class FramePool;
+
+    /**
+     * Reference counted handle to a received DATA payload. The payload
+     * starts on a cache line, so it is aligned for any frame type, and
+     * lives until the last copy of the handle is gone, on whatever
+     * thread that happens.
+     */
+    class FrameBuffer
+    {
+      public:
+
+        static constexpr size_t ALIGNMENT = 64;
+
+        struct alignas(ALIGNMENT) Slab
+        {
+            std::atomic<uint32_t> references { 0 };
+            std::atomic<uint32_t> next { 0 };
+            uint32_t index = 0;
+            uint16_t length = 0;
+            uint16_t commandId = 0;
+            uint8_t sequence = 0;
+            void* storage = nullptr;  // owning pool storage, null for a heap slab
+
+            inline byte_t* payload()
+            {
+                return reinterpret_cast<byte_t*>(this) + sizeof(Slab);
+            }
+        };
+
+      private:
+
+        Slab* slab = nullptr;
+
+        explicit FrameBuffer(Slab* slab) : slab(slab) {}
+
+        static void recycle(Slab* slab);
+
+        inline void release()
+        {
+            if (this->slab != nullptr && this->slab->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                recycle(this->slab);
+            }
+            this->slab = nullptr;
+        }
+
+        friend class FramePool;
+
+      public:
+
+        FrameBuffer() = default;
+
+        FrameBuffer(const FrameBuffer & another) : slab(another.slab)
+        {
+            if (this->slab != nullptr) {
+                this->slab->references.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        FrameBuffer(FrameBuffer && another) noexcept : slab(another.slab)
+        {
+            another.slab = nullptr;
+        }
+
+        FrameBuffer & operator=(FrameBuffer another) noexcept
+        {
+            std::swap(this->slab, another.slab);
+            return *this;
+        }
+
+        ~FrameBuffer()
+        {
+            this->release();
+        }
+
+        explicit operator bool() const
+        {
+            return this->slab != nullptr;
+        }
+
+        [[nodiscard]]
+        inline const byte_t* data() const
+        {
+            return this->slab->payload();
+        }
+
+        /**
+         * Only meant for the producer that fills a freshly acquired buffer
+         */
+        inline byte_t* mutableData()
+        {
+            return this->slab->payload();
+        }
+
+        [[nodiscard]]
+        inline size_t size() const
+        {
+            return this->slab->length;
+        }
+
+        [[nodiscard]]
+        inline uint16_t commandId() const
+        {
+            return this->slab->commandId;
+        }
+
+        [[nodiscard]]
+        inline uint8_t sequence() const
+        {
+            return this->slab->sequence;
+        }
+
+        inline void setHeader(uint16_t commandId, uint8_t sequence)
+        {
+            this->slab->commandId = commandId;
+            this->slab->sequence = sequence;
+        }
+
+        /**
+         * @return the payload as `T`, null if it is shorter than `T`
+         */
+        template <typename T>
+        [[nodiscard]] const T* as() const
+        {
+            static_assert(alignof(T) <= ALIGNMENT, "frame type is over-aligned");
+            if (this->slab == nullptr || this->slab->length < sizeof(T)) {
+                return nullptr;
+            }
+            return reinterpret_cast<const T*>(this->slab->payload());
+        }
+
+        [[nodiscard]]
+        inline uint32_t useCount() const
+        {
+            return this->slab == nullptr ? 0 : this->slab->references.load(std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Typed view of a `FrameBuffer` whose length was checked against
+     * `sizeof(CmdData)`, cheap to copy and safe to keep or queue
+     */
+    template <typename CmdData>
+    class FrameRef
+    {
+      private:
+
+        FrameBuffer buffer;
+
+      public:
+
+        FrameRef() = default;
+
+        explicit FrameRef(FrameBuffer buffer) : buffer(buffer.as<CmdData>() ? std::move(buffer) : FrameBuffer()) {}
+
+        explicit operator bool() const
+        {
+            return static_cast<bool>(this->buffer);
+        }
+
+        inline const CmdData & operator*() const
+        {
+            return *this->buffer.template as<CmdData>();
+        }
+
+        inline const CmdData* operator->() const
+        {
+            return this->buffer.template as<CmdData>();
+        }
+
+        [[nodiscard]]
+        inline const FrameBuffer & raw() const
+        {
+            return this->buffer;
+        }
+    };
+
+    /**
+     * Fixed number of equally sized, cache-line aligned slabs in one
+     * allocation, handed out through a lock-free free list. Buffers may
+     * be released from any thread and may outlive the pool. Payloads that
+     * do not fit a slab, or arrive while every slab is in use, get a
+     * slab of their own from the heap.
+     */
+    class FramePool
+    {
+      public:
+
+        struct Options
+        {
+            size_t slabs = 128;
+            size_t slabSize = 192;  // payload bytes per slab
+        };
+
+        struct Statistics
+        {
+            uint64_t acquired;
+            uint64_t oversized;
+            uint64_t exhausted;
+            size_t inUse;
+        };
+
+      private:
+
+        // slabs, free list and counters, shared with outstanding buffers
+        struct Storage;
+
+        Storage* storage;
+
+        friend class FrameBuffer;
+
+      public:
+
+        FramePool();
+
+        explicit FramePool(const Options & options);
+
+        FramePool(const FramePool &) = delete;
+
+        FramePool & operator=(const FramePool &) = delete;
+
+        ~FramePool();
+
+        /**
+         * @return a buffer with room for `length` bytes, length already set
+         */
+        FrameBuffer acquire(size_t length);
+
+        [[nodiscard]]
+        Statistics statistics() const;
+    };
+}
+
+#endif // SERIAL_FRAME_POOL_HPP
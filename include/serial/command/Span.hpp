@@ -0,0 +1,73 @@
+#ifndef SERIAL_SPAN_HPP
+#define SERIAL_SPAN_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace serial::command
+{
+    /**
+     * Read-only view of `size()` consecutive elements, the payload of a
+     * variable length frame. Valid only for as long as what it views.
+     */
+    template <typename T>
+    class Span
+    {
+      private:
+
+        const T* pointer = nullptr;
+        size_t count = 0;
+
+      public:
+
+        Span() = default;
+
+        Span(const T* data, size_t size) : pointer(data), count(size) {}
+
+        Span(const std::vector<T> & elements) : pointer(elements.data()), count(elements.size()) {}
+
+        template <size_t N>
+        Span(const T (& elements)[N]) : pointer(elements), count(N) {}
+
+        [[nodiscard]]
+        inline const T* data() const
+        {
+            return this->pointer;
+        }
+
+        [[nodiscard]]
+        inline size_t size() const
+        {
+            return this->count;
+        }
+
+        [[nodiscard]]
+        inline size_t sizeBytes() const
+        {
+            return this->count * sizeof(T);
+        }
+
+        [[nodiscard]]
+        inline bool empty() const
+        {
+            return this->count == 0;
+        }
+
+        inline const T & operator[](size_t index) const
+        {
+            return this->pointer[index];
+        }
+
+        inline const T* begin() const
+        {
+            return this->pointer;
+        }
+
+        inline const T* end() const
+        {
+            return this->pointer + this->count;
+        }
+    };
+}
+
+#endif // SERIAL_SPAN_HPP
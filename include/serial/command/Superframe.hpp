@@ -0,0 +1,95 @@
+#ifndef SERIAL_SUPERFRAME_HPP
+#define SERIAL_SUPERFRAME_HPP
+
+#include "CommandFrame.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace serial::command
+{
+    /**
+     * A frame with command id `COMMAND` whose DATA is a sequence of
+     * records, each the command id (little endian), the payload length
+     * and the payload. Lengths below 0x80 take one byte, longer ones up
+     * to `MAX_RECORD_LENGTH` two, high bits first with 0x80 set. Many
+     * small commands then share one header and one CRC16.
+     */
+    namespace Superframe
+    {
+        constexpr uint16_t COMMAND = 0xFFFF;   // reserved, never dispatched itself
+        constexpr size_t MAX_RECORD_LENGTH = 0x7FFF;
+
+        constexpr size_t recordHeaderSize(size_t length)
+        {
+            return length < 0x80 ? 3 : 4;
+        }
+
+        /**
+         * @return bytes written, `recordHeaderSize(length)`
+         */
+        inline size_t writeRecordHeader(byte_t* output, uint16_t commandId, size_t length)
+        {
+            output[0] = (byte_t) (commandId & 0xFF);
+            output[1] = (byte_t) (commandId >> 8);
+            if (length < 0x80) {
+                output[2] = (byte_t) length;
+                return 3;
+            }
+            output[2] = (byte_t) (0x80 | (length >> 8));
+            output[3] = (byte_t) (length & 0xFF);
+            return 4;
+        }
+
+        /**
+         * Walks the records of a superframe's DATA
+         */
+        class Reader
+        {
+          private:
+
+            const byte_t* data;
+            size_t size;
+            size_t position = 0;
+            bool malformed = false;
+
+          public:
+
+            Reader(const byte_t* data, size_t size) : data(data), size(size) {}
+
+            /**
+             * @return false after the last record or at one that runs past the end
+             */
+            bool next(uint16_t & commandId, const byte_t* & payload, size_t & length)
+            {
+                if (this->position == this->size) {
+                    return false;
+                }
+                size_t left = this->size - this->position;
+                const byte_t* record = this->data + this->position;
+                if (left < 3 || (record[2] & 0x80 && left < 4)) {
+                    this->malformed = true;
+                    return false;
+                }
+                size_t header = record[2] & 0x80 ? 4 : 3;
+                length = header == 3 ? record[2] : (size_t) ((record[2] & 0x7F) << 8 | record[3]);
+                if (left - header < length) {
+                    this->malformed = true;
+                    return false;
+                }
+                commandId = (uint16_t) (record[0] | record[1] << 8);
+                payload = record + header;
+                this->position += header + length;
+                return true;
+            }
+
+            [[nodiscard]]
+            inline bool failed() const
+            {
+                return this->malformed;
+            }
+        };
+    }
+}
+
+#endif // SERIAL_SUPERFRAME_HPP
@@ -1,11 +1,24 @@
-
 #ifndef LOGGER_HPP
 #define LOGGER_HPP
 
-#include <string>
-#include <iostream>
+#include <atomic>
 #include <chrono>
-#include <iomanip>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+/**
+ * Calls above this level compile to nothing, `LOG_NONE` removes them all.
+ * Set it with `-DLOGGER_LEVEL=LOG_WARNING` or `LOG_LEVEL` in CMakeLists.txt.
+ */
+#ifndef LOGGER_LEVEL
+#define LOGGER_LEVEL LOG_DEBUG
+#endif
 
 namespace logger
 {
@@ -22,106 +35,262 @@ namespace logger
             LOG_DEBUG   =   4,
         };
 
-        static LogLevel level = LOG_DEBUG;
+        constexpr LogLevel compiled = LOGGER_LEVEL;
+
+        // one level for the whole program, the library included
+        inline std::atomic<LogLevel> level { LOG_INFO };
     }
 
     using level::LogLevel;
 
     static inline void setLogLevel(LogLevel lvl)
     {
-        logger::level::level = lvl;
+        logger::level::level.store(lvl, std::memory_order_relaxed);
     }
 
-    namespace io
+    /**
+     * Format and write on a background thread from now on. A log call
+     * then only copies its arguments into a lock-free queue, messages
+     * that find the queue full are dropped and counted.
+     * @param capacity queued messages, rounded up to a power of two,
+     *                 only the first call allocates
+     */
+    void startAsync(size_t capacity = 4096);
+
+    /**
+     * Write what is queued and go back to writing on the calling thread
+     */
+    void stopAsync();
+
+    /**
+     * Block until every message logged so far has been written
+     */
+    void flush();
+
+    /**
+     * Lets `burst` messages per `interval` through and counts the rest,
+     * the next message that passes reports how many were suppressed.
+     * Keep one per call site, next to the code that logs.
+     */
+    class RateLimiter
     {
-        using namespace std::chrono;
-        using SysClock = std::chrono::system_clock;
-        using StrStream = std::stringstream;
+      private:
+
+        using Clock = std::chrono::steady_clock;
+
+        int64_t interval;
+        uint32_t burst;
+        std::atomic<int64_t> windowEnd { 0 };
+        std::atomic<uint32_t> passed { 0 };
+        std::atomic<uint64_t> suppressed { 0 };
 
-        static inline void printErrLn(StrStream & stream)
+      public:
+
+        explicit RateLimiter(std::chrono::milliseconds interval = std::chrono::seconds(1), uint32_t burst = 1)
+            : interval(std::chrono::duration_cast<Clock::duration>(interval).count()), burst(burst) {}
+
+        /**
+         * @param dropped set to the messages suppressed since the last one let through
+         * @return whether this message may be logged
+         */
+        inline bool allow(uint64_t & dropped)
         {
-            std::cerr << stream.str() << '\n';
+            int64_t now = Clock::now().time_since_epoch().count();
+            int64_t end = this->windowEnd.load(std::memory_order_relaxed);
+            if (now >= end && this->windowEnd.compare_exchange_strong(end, now + this->interval, std::memory_order_relaxed)) {
+                this->passed.store(0, std::memory_order_relaxed);
+            }
+            if (this->passed.fetch_add(1, std::memory_order_relaxed) < this->burst) {
+                dropped = this->suppressed.exchange(0, std::memory_order_relaxed);
+                return true;
+            }
+            this->suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
+    };
 
-        template<typename T, typename ... Ts>
-        static void printErrLn(StrStream & stream, const T & first, const Ts &... tail)
+    namespace io
+    {
+        enum class Tag : uint8_t
         {
-            stream << first;
-            printErrLn(stream, tail...);
-        }
+            STRING,
+            SIGNED,
+            UNSIGNED,
+            FLOATING,
+            CHARACTER,
+            BOOLEAN,
+        };
+
+        /**
+         * A log call as captured on the calling thread: level, time,
+         * thread and the tagged raw arguments, nothing formatted yet
+         */
+        struct Record
+        {
+            static constexpr size_t CAPACITY = 224;
+
+            LogLevel level;
+            bool truncated;
+            uint16_t length;       // bytes of `arguments` in use
+            int64_t time;          // system clock, nanoseconds since the epoch
+            std::thread::id thread;
+            unsigned char arguments[CAPACITY];
+        };
 
-      #define COLOR_DEF(color, code)  static const char* color = "\033[0;" #code "m"
+        static_assert(std::is_trivially_copyable_v<Record>, "records are copied into the queue with memcpy");
 
-        COLOR_DEF(RED,      31);
-        COLOR_DEF(GREEN,    32);
-        COLOR_DEF(YELLOW,   33);
-        COLOR_DEF(BLUE,     34);
-        COLOR_DEF(CYAN,     36);
+        /**
+         * Write the record now or queue it for the background thread
+         */
+        void submit(const Record & record);
 
-      #undef COLOR_DEF
+        /**
+         * Append the record as one line, colored label and timestamp first
+         */
+        void format(const Record & record, string & line);
 
-        static inline string colorString(const string & s, const char* color)
+        static inline void append(Record & record, Tag tag, const void* value, size_t size)
         {
-            return string(color) + s + "\033[0m";
+            if (record.length + 1 + size > Record::CAPACITY) {
+                record.truncated = true;
+                return;
+            }
+            record.arguments[record.length] = (unsigned char) tag;
+            std::memcpy(record.arguments + record.length + 1, value, size);
+            record.length += (uint16_t) (1 + size);
         }
 
-        static inline string timeString()
+        static inline void appendString(Record & record, std::string_view text)
         {
-            StrStream timeFormat;
-            char buffer[64];
-            auto now = SysClock::now();
-            long millisecond = duration_cast<milliseconds>(now.time_since_epoch()).count() % 1000;
-            timeFormat << "%Y-%m-%d %H:%M:%S." << std::setw(3) << std::setfill('0') << millisecond;
-            time_t timeNow = SysClock::to_time_t(now);
-            std::strftime(buffer, sizeof(buffer), timeFormat.str().c_str(), std::localtime(&timeNow));
-            return buffer;
+            size_t room = Record::CAPACITY - record.length;
+            if (room < 1 + sizeof(uint16_t)) {
+                record.truncated = true;
+                return;
+            }
+            room -= 1 + sizeof(uint16_t);
+            if (text.size() > room) {
+                text = text.substr(0, room);
+                record.truncated = true;
+            }
+            auto size = (uint16_t) text.size();
+            record.arguments[record.length] = (unsigned char) Tag::STRING;
+            std::memcpy(record.arguments + record.length + 1, &size, sizeof(size));
+            std::memcpy(record.arguments + record.length + 1 + sizeof(size), text.data(), size);
+            record.length += (uint16_t) (1 + sizeof(size) + size);
         }
 
-        template<typename ... Ts>
-        static inline void log(const string & label, const char* color, const Ts &... args)
+        template <typename T>
+        static inline void encode(Record & record, const T & value)
         {
-            StrStream stream;
-            stream << io::colorString("[", io::BLUE);
-            stream << io::colorString(label, color);
-          #ifdef _GLIBCXX_THREAD
-            stream << "T" << std::this_thread::get_id() << " ";
-          #endif
-            stream << io::timeString() << " ";
-            stream << io::colorString("]", io::BLUE) << " ";
-            io::printErrLn(stream, args...);
+            using Type = std::decay_t<T>;
+            if constexpr (std::is_same_v<Type, bool>) {
+                bool copy = value;
+                append(record, Tag::BOOLEAN, &copy, sizeof(copy));
+            } else if constexpr (std::is_same_v<Type, char> || std::is_same_v<Type, signed char> || std::is_same_v<Type, unsigned char>) {
+                char copy = (char) value;
+                append(record, Tag::CHARACTER, &copy, sizeof(copy));
+            } else if constexpr (std::is_integral_v<Type> && std::is_signed_v<Type>) {
+                auto copy = (int64_t) value;
+                append(record, Tag::SIGNED, &copy, sizeof(copy));
+            } else if constexpr (std::is_integral_v<Type>) {
+                auto copy = (uint64_t) value;
+                append(record, Tag::UNSIGNED, &copy, sizeof(copy));
+            } else if constexpr (std::is_enum_v<Type>) {
+                encode(record, (std::underlying_type_t<Type>) value);
+            } else if constexpr (std::is_floating_point_v<Type>) {
+                auto copy = (double) value;
+                append(record, Tag::FLOATING, &copy, sizeof(copy));
+            } else if constexpr (std::is_array_v<T> && (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>)) {
+                // an array argument is an object of its own, never null; up to its
+                // first NUL, or the whole buffer if it has none
+                appendString(record, std::string_view(value, ::strnlen(value, std::extent_v<T>)));
+            } else if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>) {
+                appendString(record, value == nullptr ? "(null)" : std::string_view(value));
+            } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+                appendString(record, std::string_view(value));
+            } else {
+                // anything else prints itself, on the calling thread
+                std::ostringstream stream;
+                stream << value;
+                appendString(record, stream.str());
+            }
+        }
+
+        template <typename ... Ts>
+        static inline void log(LogLevel level, const Ts &... args)
+        {
+            Record record;
+            record.level = level;
+            record.truncated = false;
+            record.length = 0;
+            record.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            ).count();
+            record.thread = std::this_thread::get_id();
+            (encode(record, args), ...);
+            submit(record);
+        }
+
+        template <LogLevel Level, typename ... Ts>
+        static inline void logAt(const Ts &... args)
+        {
+            if constexpr (level::compiled >= Level) {
+                if (level::level.load(std::memory_order_relaxed) >= Level) {
+                    log(Level, args...);
+                }
+            }
+        }
+
+        template <LogLevel Level, typename ... Ts>
+        static inline void logAt(RateLimiter & limiter, const Ts &... args)
+        {
+            if constexpr (level::compiled >= Level) {
+                uint64_t dropped = 0;
+                if (level::level.load(std::memory_order_relaxed) >= Level && limiter.allow(dropped)) {
+                    if (dropped > 0) {
+                        log(Level, args..., " (", dropped, " similar messages suppressed)");
+                    } else {
+                        log(Level, args...);
+                    }
+                }
+            }
         }
     }
 
     template<typename ... Ts>
     static inline void debug(const Ts &... args)
     {
-        if (logger::level::level >= logger::level::LOG_DEBUG) {
-            logger::io::log(" DEBUG ", io::CYAN, args...);
-        }
+        io::logAt<level::LOG_DEBUG>(args...);
     }
 
     template<typename ... Ts>
     static inline void info(const Ts &... args)
     {
-        if (logger::level::level >= logger::level::LOG_INFO) {
-            logger::io::log(" INFO  ", io::GREEN, args...);
-        }
+        io::logAt<level::LOG_INFO>(args...);
     }
 
     template<typename ... Ts>
     static inline void warning(const Ts &... args)
     {
-        if (logger::level::level >= logger::level::LOG_WARNING) {
-            logger::io::log(" WARN  ", io::YELLOW, args...);
-        }
+        io::logAt<level::LOG_WARNING>(args...);
+    }
+
+    template<typename ... Ts>
+    static inline void warning(RateLimiter & limiter, const Ts &... args)
+    {
+        io::logAt<level::LOG_WARNING>(limiter, args...);
     }
 
     template<typename ... Ts>
     static inline void error(const Ts &... args)
     {
-        if (logger::level::level >= logger::level::LOG_ERROR) {
-            logger::io::log(" ERROR ", io::RED, args...);
-        }
+        io::logAt<level::LOG_ERROR>(args...);
+    }
+
+    template<typename ... Ts>
+    static inline void error(RateLimiter & limiter, const Ts &... args)
+    {
+        io::logAt<level::LOG_ERROR>(limiter, args...);
     }
 }
 
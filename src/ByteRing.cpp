@@ -0,0 +1,128 @@
+#include "serial/ByteRing.hpp"
+
+#define func auto
+
+namespace serial
+{
+    static func roundUpPowerOfTwo(size_t value) -> size_t
+    {
+        size_t power = 1;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    ByteRing::ByteRing(size_t capacity)
+    {
+        this->capacity = roundUpPowerOfTwo(capacity < 64 ? 64 : capacity);
+        this->mask = this->capacity - 1;
+        this->buffer = std::make_unique<byte_t[]>(this->capacity);
+    }
+
+    func ByteRing::notify(const std::atomic_bool & parked) -> void
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_relaxed)) {
+            Lock lock(this->waitMutex);
+            this->stateChanged.notify_all();
+        }
+    }
+
+    func ByteRing::writable(byte_t* & region) -> size_t
+    {
+        size_t position = this->head.load(std::memory_order_relaxed);
+        size_t free = this->capacity - (position - this->tail.load(std::memory_order_acquire));
+        size_t offset = position & this->mask;
+        size_t contiguous = this->capacity - offset;
+        region = this->buffer.get() + offset;
+        return free < contiguous ? free : contiguous;
+    }
+
+    func ByteRing::commit(size_t size) -> void
+    {
+        size_t position = this->head.load(std::memory_order_relaxed) + size;
+        this->head.store(position, std::memory_order_release);
+
+        size_t pending = position - this->tail.load(std::memory_order_relaxed);
+        if (pending > this->highWaterMark.load(std::memory_order_relaxed)) {
+            this->highWaterMark.store(pending, std::memory_order_relaxed);
+        }
+        this->notify(this->consumerParked);
+    }
+
+    func ByteRing::waitWritable(Duration timeout) -> void
+    {
+        this->fullStalls.fetch_add(1, std::memory_order_relaxed);
+        this->producerParked.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            Lock lock(this->waitMutex);
+            this->stateChanged.wait_for(lock, timeout, [this] {
+                return this->size() < this->capacity || this->isClosed();
+            });
+        }
+        this->producerParked.store(false);
+    }
+
+    func ByteRing::readable(const byte_t* & region) -> size_t
+    {
+        size_t position = this->tail.load(std::memory_order_relaxed);
+        size_t pending = this->head.load(std::memory_order_acquire) - position;
+        size_t offset = position & this->mask;
+        size_t contiguous = this->capacity - offset;
+        region = this->buffer.get() + offset;
+        return pending < contiguous ? pending : contiguous;
+    }
+
+    func ByteRing::consume(size_t size) -> void
+    {
+        this->tail.store(this->tail.load(std::memory_order_relaxed) + size, std::memory_order_release);
+        this->notify(this->producerParked);
+    }
+
+    func ByteRing::waitReadable(Duration timeout) -> bool
+    {
+        this->consumerParked.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ready;
+        {
+            Lock lock(this->waitMutex);
+            ready = this->stateChanged.wait_for(lock, timeout, [this] {
+                return this->size() > 0 || this->isClosed();
+            });
+        }
+        this->consumerParked.store(false);
+        return ready;
+    }
+
+    func ByteRing::close() -> void
+    {
+        this->closed.store(true, std::memory_order_release);
+        Lock lock(this->waitMutex);
+        this->stateChanged.notify_all();
+    }
+
+    func ByteRing::reset() -> void
+    {
+        this->head.store(0);
+        this->tail.store(0);
+        this->closed.store(false);
+    }
+
+    func ByteRing::size() const -> size_t
+    {
+        return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire);
+    }
+
+    func ByteRing::statistics() const -> Statistics
+    {
+        return Statistics {
+            this->capacity,
+            this->head.load(),
+            this->tail.load(),
+            this->highWaterMark.load(),
+            this->fullStalls.load(),
+        };
+    }
+}
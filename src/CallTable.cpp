@@ -0,0 +1,98 @@
+#include "serial/CallTable.hpp"
+#include "serial/utils/Logger.hpp"
+
+#include <algorithm>
+
+#define func auto
+
+namespace serial
+{
+    CallTable::CallTable(const TimerWheel::Options & options)
+        : wheel([this](uint64_t timer) { this->expire(timer); }, options)
+    {
+    }
+
+    func CallTable::open(uint16_t responseCommand, Duration timeout, Completion completion, uint16_t & id) -> bool
+    {
+        uint64_t timer;
+        {
+            Lock lock(this->mutex);
+            this->statistics.calls++;
+            if (this->calls.size() > UINT16_MAX) {
+                this->statistics.notSent++;
+                lock.unlock();
+                completion(Outcome::NOT_SENT, nullptr);
+                return false;
+            }
+            while (this->calls.count(this->nextId) != 0) {
+                this->nextId++;
+            }
+            id = this->nextId++;
+            timer = ++this->nextTimer << 16 | id;
+            this->calls.emplace(id, Call { responseCommand, timer, std::move(completion) });
+            this->statistics.maxOutstanding = std::max(this->statistics.maxOutstanding, this->calls.size());
+        }
+        this->wheel.schedule(timer, timeout);
+        return true;
+    }
+
+    func CallTable::abandon(uint16_t id) -> void
+    {
+        Completion completion;
+        {
+            Lock lock(this->mutex);
+            auto call = this->calls.find(id);
+            if (call == this->calls.end()) {
+                return;
+            }
+            completion = std::move(call->second.completion);
+            this->calls.erase(call);
+            this->statistics.notSent++;
+        }
+        completion(Outcome::NOT_SENT, nullptr);
+    }
+
+    func CallTable::respond(const command::FrameView & frame) -> void
+    {
+        uint16_t id = readId(frame.data);
+        Completion completion;
+        {
+            Lock lock(this->mutex);
+            auto call = this->calls.find(id);
+            if (call == this->calls.end() || call->second.responseCommand != frame.commandId) {
+                static logger::RateLimiter limiter;
+                this->statistics.unmatched++;
+                logger::warning(limiter, "Response with command id ", frame.commandId, " to no outstanding call ", id);
+                return;
+            }
+            completion = std::move(call->second.completion);
+            this->calls.erase(call);
+            this->statistics.responses++;
+        }
+        completion(Outcome::RESPONSE, frame.data + ID_SIZE);
+    }
+
+    func CallTable::expire(uint64_t timer) -> void
+    {
+        Completion completion;
+        {
+            Lock lock(this->mutex);
+            auto call = this->calls.find((uint16_t) (timer & 0xFFFF));
+            if (call == this->calls.end() || call->second.timer != timer) {
+                return;  // answered in time
+            }
+            completion = std::move(call->second.completion);
+            this->calls.erase(call);
+            this->statistics.timeouts++;
+        }
+        completion(Outcome::TIMEOUT, nullptr);
+    }
+
+    func CallTable::getStatistics() -> Statistics
+    {
+        Lock lock(this->mutex);
+        Statistics statistics = this->statistics;
+        statistics.outstanding = this->calls.size();
+        return statistics;
+    }
+}
@@ -0,0 +1,194 @@
+#include "serial/CallbackExecutor.hpp"
+#include "serial/utils/Logger.hpp"
+
+#include <exception>
+
+#define func auto
+
+namespace serial
+{
+    using command::FrameBuffer;
+    using command::FrameView;
+
+    static thread_local bool workerThread = false;
+
+    CallbackExecutor::CallbackExecutor() : CallbackExecutor(Options()) {}
+
+    CallbackExecutor::CallbackExecutor(const Options & options, LinkStatistics* linkStatistics)
+        : options(options), linkStatistics(linkStatistics)
+    {
+        if (this->options.threads < 1) {
+            this->options.threads = 1;
+        }
+        if (this->options.queueCapacity < 1) {
+            this->options.queueCapacity = 1;
+        }
+        for (size_t i = 0; i < this->options.threads; i++) {
+            auto worker = std::make_unique<Worker>();
+            worker->ring.resize(this->options.queueCapacity);
+            this->workers.emplace_back(std::move(worker));
+        }
+        for (auto & worker : this->workers) {
+            Worker* target = worker.get();
+            worker->thread = std::thread([this, target] { this->workerDaemon(*target); });
+        }
+    }
+
+    CallbackExecutor::~CallbackExecutor()
+    {
+        for (auto & worker : this->workers) {
+            Lock lock(worker->mutex);
+            this->running = false;
+            worker->ready.notify_all();
+            worker->space.notify_all();
+        }
+        for (auto & worker : this->workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    func CallbackExecutor::submit(const command::DispatchTable::Entry & entry, const FrameBuffer & buffer,
+                                  LinkStatistics::Clock::time_point decoded) -> bool
+    {
+        uint16_t commandId = buffer.commandId();
+        Worker & worker = *this->workers[commandId % this->workers.size()];
+        const size_t capacity = worker.ring.size();
+
+        Lock lock(worker.mutex);
+        CommandStatistics & statistics = worker.commands[commandId];
+
+        while (worker.count == capacity) {
+            switch (this->options.overflow) {
+
+                case OverflowPolicy::DROP_NEWEST:
+                {
+                    statistics.droppedNewest++;
+                    return false;
+                }
+
+                case OverflowPolicy::DROP_OLDEST:
+                {
+                    Task & oldest = worker.ring[worker.head];
+                    CommandStatistics & dropped = worker.commands[oldest.buffer.commandId()];
+                    dropped.droppedOldest++;
+                    dropped.backlog--;
+                    oldest.buffer = FrameBuffer();
+                    worker.head = (worker.head + 1) % capacity;
+                    worker.count--;
+                }
+                break;
+
+                case OverflowPolicy::BLOCK:
+                {
+                    if (!this->running) {
+                        statistics.droppedNewest++;
+                        return false;
+                    }
+                    worker.space.wait(lock);
+                }
+                break;
+            }
+        }
+
+        worker.ring[(worker.head + worker.count) % capacity] = Task { entry, buffer, decoded };
+        worker.count++;
+        statistics.backlog++;
+        if (statistics.backlog > statistics.maxBacklog) {
+            statistics.maxBacklog = statistics.backlog;
+        }
+
+        // the worker only sleeps on an empty queue
+        bool wake = worker.count == 1;
+        lock.unlock();
+        if (wake) {
+            worker.ready.notify_one();
+        }
+        return true;
+    }
+
+    func CallbackExecutor::onWorkerThread() -> bool
+    {
+        return workerThread;
+    }
+
+    func CallbackExecutor::workerDaemon(Worker & worker) -> void
+    {
+        const size_t capacity = worker.ring.size();
+        workerThread = true;
+        Lock lock(worker.mutex);
+
+        while (true) {
+            worker.ready.wait(lock, [&] {
+                return worker.count > 0 || !this->running;
+            });
+            if (worker.count == 0) {
+                return;  // stopped and drained
+            }
+
+            Task task = std::move(worker.ring[worker.head]);
+            worker.head = (worker.head + 1) % capacity;
+            worker.count--;
+            worker.busy = true;
+            lock.unlock();
+            worker.space.notify_one();
+
+            FrameView frame {
+                task.buffer.commandId(),
+                task.buffer.sequence(),
+                (uint16_t) task.buffer.size(),
+                task.buffer.data(),
+                &task.buffer
+            };
+            auto start = LinkStatistics::Clock::now();
+            try {
+                task.entry.invoke(task.entry.target, frame);
+            } catch (std::exception & exception) {
+                static logger::RateLimiter limiter;
+                logger::error(limiter, "Subscriber callback for command id ", frame.commandId, " threw: ", exception.what());
+            }
+            if (this->linkStatistics != nullptr) {
+                this->linkStatistics->command(frame.commandId).called(task.decoded, start, LinkStatistics::Clock::now());
+            }
+            task.buffer = FrameBuffer();
+
+            lock.lock();
+            CommandStatistics & statistics = worker.commands[frame.commandId];
+            statistics.backlog--;
+            statistics.executed++;
+            worker.busy = false;
+            if (worker.count == 0) {
+                worker.idle.notify_all();
+            }
+        }
+    }
+
+    func CallbackExecutor::drain() -> void
+    {
+        for (auto & worker : this->workers) {
+            Lock lock(worker->mutex);
+            worker->idle.wait(lock, [&] {
+                return worker->count == 0 && !worker->busy;
+            });
+        }
+    }
+
+    func CallbackExecutor::statistics(uint16_t commandId) -> CommandStatistics
+    {
+        Worker & worker = *this->workers[commandId % this->workers.size()];
+        Lock lock(worker.mutex);
+        auto found = worker.commands.find(commandId);
+        return found == worker.commands.end() ? CommandStatistics {} : found->second;
+    }
+
+    func CallbackExecutor::statistics() -> std::unordered_map<uint16_t, CommandStatistics>
+    {
+        std::unordered_map<uint16_t, CommandStatistics> merged;
+        for (auto & worker : this->workers) {
+            Lock lock(worker->mutex);
+            merged.insert(worker->commands.begin(), worker->commands.end());
+        }
+        return merged;
+    }
+}
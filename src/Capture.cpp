@@ -0,0 +1,240 @@
+#include "serial/Capture.hpp"
+#include "serial/utils/Logger.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define func auto
+
+namespace serial
+{
+    using Lock = std::lock_guard<std::mutex>;
+
+    static constexpr size_t padding(size_t length)
+    {
+        return (CaptureRecordHeader::ALIGNMENT - length % CaptureRecordHeader::ALIGNMENT) % CaptureRecordHeader::ALIGNMENT;
+    }
+
+    static func writeAll(int fd, const unsigned char* data, size_t size) -> bool
+    {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            size -= (size_t) written;
+        }
+        return true;
+    }
+
+    CaptureWriter::CaptureWriter(size_t bufferSize) : bufferSize(bufferSize)
+    {
+        this->buffer.reserve(bufferSize + sizeof(CaptureRecordHeader) + CaptureRecordHeader::ALIGNMENT);
+    }
+
+    CaptureWriter::~CaptureWriter()
+    {
+        this->close();
+    }
+
+    func CaptureWriter::open(const String & path) -> bool
+    {
+        this->close();
+
+        Lock lock(this->mutex);
+        int file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (file == -1) {
+            logger::error("Unable to create capture file ", path, ", errno ", errno);
+            return false;
+        }
+
+        CaptureFileHeader header {};
+        std::memcpy(header.magic, CaptureFileHeader::MAGIC, sizeof(header.magic));
+        header.version = CaptureFileHeader::VERSION;
+        header.headerSize = sizeof(CaptureFileHeader);
+        header.wallClockStart = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        if (!writeAll(file, reinterpret_cast<const unsigned char*>(&header), sizeof(header))) {
+            logger::error("Unable to write capture file ", path, ", errno ", errno);
+            ::close(file);
+            return false;
+        }
+
+        this->fd = file;
+        this->start = Clock::now();
+        this->records = 0;
+        return true;
+    }
+
+    func CaptureWriter::close() -> void
+    {
+        Lock lock(this->mutex);
+        if (this->fd == -1) {
+            return;
+        }
+        this->writeBuffer();
+        ::close(this->fd);
+        this->fd = -1;
+    }
+
+    func CaptureWriter::isOpen() -> bool
+    {
+        Lock lock(this->mutex);
+        return this->fd != -1;
+    }
+
+    func CaptureWriter::size() -> uint64_t
+    {
+        Lock lock(this->mutex);
+        return this->records;
+    }
+
+    func CaptureWriter::flush() -> void
+    {
+        Lock lock(this->mutex);
+        if (this->fd != -1) {
+            this->writeBuffer();
+        }
+    }
+
+    func CaptureWriter::writeBuffer() -> void
+    {
+        if (!this->buffer.empty() && !writeAll(this->fd, this->buffer.data(), this->buffer.size())) {
+            logger::error("Capture write failed, errno ", errno);
+        }
+        this->buffer.clear();
+    }
+
+    func CaptureWriter::append(const void* data, size_t size) -> void
+    {
+        auto* bytes = static_cast<const unsigned char*>(data);
+        this->buffer.insert(this->buffer.end(), bytes, bytes + size);
+    }
+
+    func CaptureWriter::record(CaptureDirection direction, const void* data, size_t size) -> void
+    {
+        struct iovec buffer { const_cast<void*>(data), size };
+        this->record(direction, &buffer, 1, size);
+    }
+
+    func CaptureWriter::record(CaptureDirection direction, const struct iovec* buffers, int count, size_t size) -> void
+    {
+        auto now = Clock::now();
+        Lock lock(this->mutex);
+        if (this->fd == -1 || size == 0) {
+            return;
+        }
+
+        CaptureRecordHeader header {};
+        header.time = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(now - this->start).count();
+        header.length = (uint32_t) size;
+        header.direction = direction;
+        this->append(&header, sizeof(header));
+
+        for (int i = 0; i < count && size > 0; i++) {
+            size_t length = buffers[i].iov_len < size ? buffers[i].iov_len : size;
+            this->append(buffers[i].iov_base, length);
+            size -= length;
+        }
+        this->buffer.insert(this->buffer.end(), padding(header.length), 0);
+
+        this->records++;
+        if (this->buffer.size() >= this->bufferSize) {
+            this->writeBuffer();
+        }
+    }
+
+    CaptureReader::CaptureReader(const String & path)
+    {
+        this->open(path);
+    }
+
+    CaptureReader::~CaptureReader()
+    {
+        this->close();
+    }
+
+    func CaptureReader::open(const String & path) -> bool
+    {
+        this->close();
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            logger::error("Unable to open capture file ", path, ", errno ", errno);
+            return false;
+        }
+        struct stat status {};
+        if (::fstat(fd, &status) != 0 || (size_t) status.st_size < sizeof(CaptureFileHeader)) {
+            logger::error("Not a capture file: ", path);
+            ::close(fd);
+            return false;
+        }
+
+        auto size = (size_t) status.st_size;
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            logger::error("Unable to map capture file ", path, ", errno ", errno);
+            return false;
+        }
+
+        CaptureFileHeader header {};
+        std::memcpy(&header, mapped, sizeof(header));
+        if (std::memcmp(header.magic, CaptureFileHeader::MAGIC, sizeof(header.magic)) != 0
+            || header.version != CaptureFileHeader::VERSION
+            || header.headerSize < sizeof(CaptureFileHeader) || header.headerSize > size) {
+            logger::error("Not a capture file or an unsupported version: ", path);
+            ::munmap(mapped, size);
+            return false;
+        }
+
+        ::madvise(mapped, size, MADV_SEQUENTIAL);
+        this->mapping = static_cast<const unsigned char*>(mapped);
+        this->mappingSize = size;
+        this->firstRecord = header.headerSize;
+        this->position = header.headerSize;
+        this->wallClockStart = header.wallClockStart;
+        return true;
+    }
+
+    func CaptureReader::close() -> void
+    {
+        if (this->mapping != nullptr) {
+            ::munmap(const_cast<unsigned char*>(this->mapping), this->mappingSize);
+            this->mapping = nullptr;
+            this->mappingSize = 0;
+        }
+    }
+
+    func CaptureReader::next(CaptureChunk & chunk) -> bool
+    {
+        if (this->mapping == nullptr || this->mappingSize - this->position < sizeof(CaptureRecordHeader)) {
+            return false;
+        }
+        CaptureRecordHeader header {};
+        std::memcpy(&header, this->mapping + this->position, sizeof(header));
+        size_t length = header.length;
+        if (this->mappingSize - this->position - sizeof(header) < length) {
+            return false;  // cut short while it was written
+        }
+
+        chunk.time = header.time;
+        chunk.direction = header.direction;
+        chunk.data = this->mapping + this->position + sizeof(header);
+        chunk.length = length;
+
+        size_t next = this->position + sizeof(header) + length + padding(length);
+        this->position = next < this->mappingSize ? next : this->mappingSize;
+        return true;
+    }
+}
@@ -0,0 +1,75 @@
+#include "serial/command/Cobs.hpp"
+
+#include <cstring>
+
+#define func auto
+
+namespace serial::command
+{
+    static constexpr size_t MAX_BLOCK = 0xFF;
+
+    func Cobs::encode(const byte_t* data, size_t size, byte_t* output) -> size_t
+    {
+        struct iovec buffer { const_cast<byte_t*>(data), size };
+        return encode(&buffer, 1, output);
+    }
+
+    func Cobs::encode(const struct iovec* buffers, int count, byte_t* output) -> size_t
+    {
+        byte_t* code = output;       // code byte of the block being filled
+        byte_t* out = output + 1;
+        size_t run = 1;              // code value so far, 1 + bytes in the block
+
+        for (int i = 0; i < count; i++) {
+            const auto* data = static_cast<const byte_t*>(buffers[i].iov_base);
+            size_t remaining = buffers[i].iov_len;
+            while (remaining > 0) {
+                size_t room = MAX_BLOCK - run;
+                size_t span = remaining < room ? remaining : room;
+                const auto* zero = static_cast<const byte_t*>(std::memchr(data, DELIMITER, span));
+                size_t length = zero == nullptr ? span : (size_t) (zero - data);
+
+                std::memcpy(out, data, length);
+                out += length;
+                run += length;
+                data += length;
+                remaining -= length;
+
+                if (zero != nullptr) {
+                    // the zero itself is implied by the code byte
+                    *code = (byte_t) run;
+                    code = out++;
+                    run = 1;
+                    data++;
+                    remaining--;
+                } else if (run == MAX_BLOCK) {
+                    *code = (byte_t) run;
+                    code = out++;
+                    run = 1;
+                }
+            }
+        }
+        *code = (byte_t) run;
+        return (size_t) (out - output);
+    }
+
+    func Cobs::decode(const byte_t* data, size_t size, byte_t* output) -> size_t
+    {
+        size_t in = 0;
+        size_t out = 0;
+        while (in < size) {
+            size_t code = data[in++];
+            if (code == 0 || in + code - 1 > size) {
+                return SIZE_MAX;
+            }
+            size_t length = code - 1;
+            std::memcpy(output + out, data + in, length);
+            in += length;
+            out += length;
+            if (code < MAX_BLOCK && in < size) {
+                output[out++] = 0;
+            }
+        }
+        return out;
+    }
+}
@@ -1,5 +1,6 @@
 
 #include "serial/CommHandle.hpp"
+#include "serial/Reactor.hpp"
 #include "serial/command/CommandFrame.hpp"
 #include "serial/utils/Logger.hpp"
 
@@ -7,6 +8,11 @@
 #include <thread>
 #include <filesystem>
 #include <regex>
+#include <utility>
+
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 
 #define func auto
 
@@ -16,6 +22,20 @@ using Regex = std::regex;
 
 namespace serial
 {
+    // set while the receiving thread handles frames, subscribers and the coroutines they resume included
+    static thread_local bool onReceivingPath = false;
+
+    // sets `onReceivingPath` for a scope and restores it, also when a subscriber throws
+    struct ReceivingPath
+    {
+        bool previous = std::exchange(onReceivingPath, true);
+
+        ~ReceivingPath()
+        {
+            onReceivingPath = previous;
+        }
+    };
+
     func getDevices() -> std::vector<String>
     {
         static const Regex SERIAL_DEV_PATTERN("\\/dev\\/tty(USB|ACM)[0-9]+");
@@ -30,6 +50,25 @@ namespace serial
         return serialDevices;
     }
 
+    static func applyThreadOptions(int cpu, int realtimePriority) -> void
+    {
+        if (cpu >= 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(cpu, &cpus);
+            if (::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus) != 0) {
+                logger::warning("Unable to pin receiving thread to cpu ", cpu);
+            }
+        }
+        if (realtimePriority > 0) {
+            struct sched_param parameter {};
+            parameter.sched_priority = realtimePriority;
+            if (::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &parameter) != 0) {
+                logger::warning("Unable to switch receiving thread to SCHED_FIFO, CAP_SYS_NICE or RLIMIT_RTPRIO needed");
+            }
+        }
+    }
+
     CommHandle::CommHandle(const String & serialDevice, int baudRate, byte_t sof)
     {
         this->receivingStateFlag.store(false);
@@ -60,9 +99,316 @@ namespace serial
     CommHandle::~CommHandle()
     {
         this->stopReceiving();
+        while (this->pipelineActive) {
+            // the reader notices the stop within one poll timeout
+            std::this_thread::sleep_for(1ms);
+        }
+        if (this->reliable) {
+            // its timer thread releases frames held behind a gap
+            this->reliable->stopDelivery();
+        }
+        this->executor.reset();
+        this->callTable.reset();
+        this->aggregator.reset();
+        this->reliable.reset();
+        this->prioritySender.reset();
+        this->sendQueue.reset();
+        this->coalescer.reset();
         this->serialPort.close();
     }
 
+    func CommHandle::writeDirect(const struct iovec* buffers, int count) -> int
+    {
+        std::lock_guard<Mutex> lock(this->sendMutex);
+        return this->sendGuarded([&](SerialControl & port) {
+            return port.send(buffers, count);
+        });
+    }
+
+    func CommHandle::writeBuffers(const struct iovec* buffers, int count) -> int
+    {
+        if (this->prioritySender) {
+            size_t size = 0;
+            for (int i = 0; i < count; i++) {
+                size += buffers[i].iov_len;
+            }
+            return this->prioritySender->push(Priority::NORMAL, buffers, count) ? (int) size : 0;
+        }
+        if (this->sendQueue) {
+            int queued = 0;
+            for (int i = 0; i < count; i++) {
+                if (this->sendQueue->push(buffers[i].iov_base, buffers[i].iov_len)) {
+                    queued += (int) buffers[i].iov_len;
+                }
+            }
+            return queued;
+        }
+        if (this->coalescer) {
+            this->coalescer->flush();
+        }
+        return this->writeDirect(buffers, count);
+    }
+
+    func CommHandle::enableCoalescing(size_t maxBytes, std::chrono::microseconds maxDelay) -> void
+    {
+        this->coalescer = std::make_unique<WriteCoalescer>(
+            [this](const struct iovec* buffers, int count) -> int {
+                return this->writeDirect(buffers, count);
+            },
+            maxBytes, maxDelay
+        );
+    }
+
+    func CommHandle::enableAsyncSend(const SendQueue::Options & options) -> void
+    {
+        this->sendQueue = std::make_unique<SendQueue>(
+            [this](const struct iovec* buffers, int count) -> int {
+                return this->writeDirect(buffers, count);
+            },
+            options
+        );
+    }
+
+    func CommHandle::disableAsyncSend() -> void
+    {
+        this->sendQueue.reset();
+    }
+
+    func CommHandle::sendQueueStatistics() const -> SendQueue::Statistics
+    {
+        if (this->sendQueue) {
+            return this->sendQueue->statistics();
+        }
+        return SendQueue::Statistics {};
+    }
+
+    func CommHandle::enablePriorityLanes(const PrioritySender::Options & options) -> void
+    {
+        this->prioritySender = std::make_unique<PrioritySender>(
+            [this](const struct iovec* buffers, int count) -> int {
+                return this->writeDirect(buffers, count);
+            },
+            options
+        );
+    }
+
+    func CommHandle::disablePriorityLanes() -> void
+    {
+        this->prioritySender.reset();
+    }
+
+    func CommHandle::priorityLaneStatistics() const -> PrioritySender::Statistics
+    {
+        if (this->prioritySender) {
+            return this->prioritySender->statistics();
+        }
+        return PrioritySender::Statistics {};
+    }
+
+    func CommHandle::enableReliable(const ReliableChannel::Options & options) -> void
+    {
+        this->reliable = std::make_unique<ReliableChannel>(
+            [this](uint16_t commandId, const byte_t* data, size_t length, byte_t sequence, std::vector<byte_t> & bytes) {
+                DynamicCommandFrame frame(commandId, data, length, this->sof, sequence);
+                struct iovec buffers[3];
+                frame.buffers(buffers);
+                this->encodeFrame(buffers, 3, frame.frameSize(), bytes);
+            },
+            [this](const byte_t* frame, size_t size, Priority priority) -> bool {
+                struct iovec buffer { const_cast<byte_t*>(frame), size };
+                return this->sendEncoded(&buffer, 1, size, priority);
+            },
+            [this](const byte_t* data, size_t size) {
+                DynamicCommandFrame frame(ReliableChannel::ACK_COMMAND, data, size, this->sof, 0);
+                struct iovec buffers[3];
+                frame.buffers(buffers);
+                this->sendFrame(buffers, 3, frame.frameSize(), Priority::HIGH);
+            },
+            [this](const FrameView & frame) {
+                this->dispatch(frame);
+            },
+            [this](Priority priority) {
+                return this->prioritySender ? this->prioritySender->backlog(priority) : PrioritySender::Duration(0);
+            },
+            this->framePool.get(), options
+        );
+    }
+
+    func CommHandle::disableReliable() -> void
+    {
+        this->reliable.reset();
+    }
+
+    func CommHandle::reliableStatistics() const -> ReliableChannel::Statistics
+    {
+        if (this->reliable) {
+            return this->reliable->statistics();
+        }
+        return ReliableChannel::Statistics {};
+    }
+
+    func CommHandle::setFramePool(const FramePool::Options & options) -> void
+    {
+        this->framePool = std::make_unique<FramePool>(options);
+        this->decoder.setPool(this->framePool.get());
+    }
+
+    func CommHandle::framePoolStatistics() const -> FramePool::Statistics
+    {
+        return this->framePool->statistics();
+    }
+
+    func CommHandle::enableExecutor(const CallbackExecutor::Options & options) -> void
+    {
+        this->executor = std::make_unique<CallbackExecutor>(options, &this->linkStatistics);
+    }
+
+    func CommHandle::disableExecutor() -> void
+    {
+        this->executor.reset();
+    }
+
+    func CommHandle::executorStatistics() -> std::unordered_map<uint16_t, CallbackExecutor::CommandStatistics>
+    {
+        if (this->executor) {
+            return this->executor->statistics();
+        }
+        return {};
+    }
+
+    func CommHandle::setReceiveRing(size_t bytes) -> void
+    {
+        if (this->pipelineActive) {
+            logger::warning("Receive ring cannot be changed while receiving");
+            return;
+        }
+        if (bytes == 0) {
+            this->receiveRing.reset();
+        } else {
+            this->receiveRing = std::make_unique<ByteRing>(bytes);
+        }
+    }
+
+    func CommHandle::receiveRingStatistics() const -> ByteRing::Statistics
+    {
+        if (this->receiveRing) {
+            return this->receiveRing->statistics();
+        }
+        return ByteRing::Statistics {};
+    }
+
+    func CommHandle::startCapture(const String & path) -> bool
+    {
+        if (!this->captureWriter) {
+            // kept until destruction, a read in flight may still hold it
+            this->captureWriter = std::make_unique<CaptureWriter>();
+        }
+        if (!this->captureWriter->open(path)) {
+            return false;
+        }
+        this->serialPort.setCapture(this->captureWriter.get());
+        return true;
+    }
+
+    func CommHandle::stopCapture() -> void
+    {
+        this->serialPort.setCapture(nullptr);
+        if (this->captureWriter) {
+            this->captureWriter->close();
+        }
+    }
+
+    func CommHandle::replay(const String & path, const ReplayOptions & options) -> ReplayResult
+    {
+        using Clock = std::chrono::steady_clock;
+
+        ReplayResult result {};
+        if (this->isReceiving() || this->pipelineActive || this->readerActive) {
+            // a stopped receiving thread may still be blocked in its last read
+            logger::warning("Cannot replay a capture while receiving");
+            return result;
+        }
+        CaptureReader reader;
+        if (!reader.open(path)) {
+            return result;
+        }
+
+        this->decoder.reset();
+        uint64_t framesBefore = this->decoder.getStatistics().frames;
+        Clock::time_point start = Clock::now();
+        uint64_t firstTime = 0;
+
+        CaptureChunk chunk {};
+        while (reader.next(chunk)) {
+            if (chunk.direction != options.direction) {
+                continue;
+            }
+            if (options.originalTiming && options.speed > 0) {
+                if (result.chunks == 0) {
+                    firstTime = chunk.time;
+                }
+                auto offset = std::chrono::nanoseconds((int64_t) ((double) (chunk.time - firstTime) / options.speed));
+                std::this_thread::sleep_until(start + offset);
+            }
+            this->processBytes(chunk.data, chunk.length);
+            result.chunks++;
+            result.bytes += chunk.length;
+        }
+        if (this->executor) {
+            this->executor->drain();
+        }
+
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        result.frames = this->decoder.getStatistics().frames - framesBefore;
+        result.framesPerSecond = result.seconds > 0 ? (double) result.frames / result.seconds : 0;
+        this->decoder.reset();
+        return result;
+    }
+
+    func CommHandle::disableCoalescing() -> void
+    {
+        this->coalescer.reset();
+    }
+
+    func CommHandle::enableAggregation(size_t maxBytes, std::chrono::microseconds maxDelay) -> void
+    {
+        this->aggregator = std::make_unique<FrameAggregator>(
+            [this](uint16_t commandId, const byte_t* data, size_t length) -> bool {
+                return this->framePayload(commandId, data, length, Priority::NORMAL);
+            },
+            maxBytes, maxDelay
+        );
+    }
+
+    func CommHandle::disableAggregation() -> void
+    {
+        this->aggregator.reset();
+    }
+
+    func CommHandle::aggregationStatistics() const -> FrameAggregator::Statistics
+    {
+        if (this->aggregator) {
+            return this->aggregator->getStatistics();
+        }
+        return FrameAggregator::Statistics {};
+    }
+
+    func CommHandle::flush() -> void
+    {
+        if (this->aggregator) {
+            this->aggregator->flush();
+        }
+        if (this->prioritySender) {
+            this->prioritySender->flush();
+        }
+        if (this->coalescer) {
+            this->coalescer->flush();
+        }
+        if (this->sendQueue) {
+            this->sendQueue->flush();
+        }
+    }
+
     func CommHandle::openSerialDevice(const String & device, int baud, byte_t sof) -> void
     {
         this->sof = sof;
@@ -75,6 +421,9 @@ namespace serial
             logger::error("Unable to open serial device ", device, ", retrying...");
             std::this_thread::sleep_for(1000ms);
         }
+        this->serialDevice = device;
+        this->applyPortOptions();
+        this->connections++;
         logger::info("Successfully connected to serial device ", device);
     }
 
@@ -90,14 +439,42 @@ namespace serial
             }
             std::this_thread::sleep_for(1000ms);
         }
+        this->applyPortOptions();
+        this->connections++;
         logger::info("Successfully connected to serial device ", serialDevices.front());
     }
 
+    func CommHandle::applyPortOptions() -> void
+    {
+        const ReceiveOptions & options = this->receiveOptions;
+        // VMIN = VTIME = 0 makes reads return at once without touching
+        // O_NONBLOCK, which would also make writes fail on a full buffer
+        bool applied = options.busyPoll
+            ? this->serialPort.setReadTimeouts(0, 0)
+            : this->serialPort.setReadTimeouts(options.vmin, options.vtime);
+        if (!applied) {
+            logger::warning("Unable to set VMIN/VTIME on serial device");
+        }
+        if (options.lowLatency && !this->serialPort.setLowLatency(true)) {
+            logger::info("Serial driver does not support ASYNC_LOW_LATENCY");
+        }
+    }
+
+    func CommHandle::setReceiveOptions(const ReceiveOptions & options) -> void
+    {
+        this->receiveOptions = options;
+        this->decoder.setMaxDataLength(options.maxDataLength);
+        if (this->serialPort.isOpen()) {
+            this->applyPortOptions();
+        }
+    }
+
     func CommHandle::reconnect() -> void
     {
         this->reconnectionMutex.lock();
         if (!this->serialPort.isOpen()) {
             logger::info("Reconnecting...");
+            this->serialPort.close();
             if (this->serialDevice.empty()) {
                 this->autoConnect(this->baudRate);
             } else {
@@ -107,15 +484,46 @@ namespace serial
         this->reconnectionMutex.unlock();
     }
 
+    func CommHandle::tryReconnect() -> bool
+    {
+        std::unique_lock<Mutex> lock(this->reconnectionMutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return false;  // another thread is reconnecting
+        }
+        if (this->serialPort.isOpen()) {
+            return true;
+        }
+        this->serialPort.close();
+        String device = this->serialDevice;
+        static logger::RateLimiter limiter;
+        if (device.empty()) {
+            std::vector<String> serialDevices = getDevices();
+            if (serialDevices.empty()) {
+                logger::warning(limiter, "No serial device found, retrying...");
+                return false;
+            }
+            device = serialDevices.front();
+        }
+        if (!this->serialPort.open(device, this->baudRate)) {
+            logger::error(limiter, "Unable to open serial device ", device, ", retrying...");
+            return false;
+        }
+        this->applyPortOptions();
+        this->connections++;
+        logger::info("Successfully connected to serial device ", device);
+        return true;
+    }
+
     func CommHandle::startReceiving() -> bool
     {
         if (!this->isReceiving()) {
+            this->receivingStateFlag = true;
             this->receivingDaemonThread = Thread(receivingDaemon());
             if (receivingDaemonThread.joinable()) {
-                this->receivingStateFlag = true;
                 receivingDaemonThread.join();
                 return this->receivingStateFlag;
             } else {
+                this->receivingStateFlag = false;
                 return false;
             }
         }
@@ -125,196 +533,545 @@ namespace serial
     func CommHandle::startReceivingAsync() -> bool
     {
         if (!this->isReceiving()) {
+            this->receivingStateFlag = true;
             this->receivingDaemonThread = Thread(receivingDaemon());
             if (receivingDaemonThread.joinable()) {
-                this->receivingStateFlag = true;
                 receivingDaemonThread.detach();
                 return this->receivingStateFlag;
             } else {
+                this->receivingStateFlag = false;
                 return false;
             }
         }
         return true;
     }
 
+    func CommHandle::stopReceiving() -> void
+    {
+        if (this->reactor != nullptr) {
+            this->reactor->remove(*this);
+        }
+        this->receivingStateFlag = false;
+    }
+
     func CommHandle::getReceivingDaemonThread() -> Thread&
     {
         return this->receivingDaemonThread;
     }
 
-    func CommHandle::receivingDaemon() -> Function<void()>
+    func CommHandle::readPort(byte_t* buffer, size_t size) -> int
     {
-        return [this]() -> void
-        {
-            const size_t BUFFER_SIZE = 1024;
-            byte_t buffer[BUFFER_SIZE];
+        int received = -1;
 
-            using Crc8  = CRC8<0x31,    0xFF,   0x00>;
-            using Crc16 = CRC16<0x1021, 0xFFFF, 0x0000>;
+        this->recvMutex.lock();
+        try {
+            received = this->serialPort.receive(buffer, size);
+        } catch (SerialClosedException & exception) {
+            this->recvMutex.unlock();
+            logger::error("Serial device connection closed");
+            if (this->doReconnect && this->reactor == nullptr) {
+                this->reconnect();
+                return -1;
+            } else {
+                throw serial::SerialClosedException();
+            }
+        }
+        this->recvMutex.unlock();
 
-            /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-            | Field | Offset   | Length (bytes) | Description                                          |
-            | ----- | -------- | -------------- | ---------------------------------------------------- |
-            | SOF   | 0        | 1              | Start of Frame, default = 0xA5                       |
-            | DLEN  | 1        | 2              | Length of DATA, little-endian uint16_t               |
-            | SEQ   | 3        | 1              | Sequence number                                      |
-            | CRC8  | 4        | 1              | p = 0x31, init = 0xFF, reflect data &  remainder     |
-            | CMD   | 5        | 2              | Command, little-endian uint16_t                      |
-            | DATA  | 7        | DLEN           | Data                                                 |
-            | CRC16 | 7 + DLEN | 2              | p = 0x1021, init = 0xFFFF, reflect data  & remainder |
-             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+        return received;
+    }
 
-            enum { SOF, DLEN, SEQ, CRC8, CMD, DATA, CRC16 } state = SOF;
+    func CommHandle::receiveAvailable(byte_t* buffer, size_t size) -> int
+    {
+        int received = this->readPort(buffer, size);
+        if (received > 0) {
+            this->processBytes(buffer, (size_t) received);
+        }
+        return received;
+    }
 
-            uint16_t dataLength;
-            uint8_t  sequence = -1;
-            uint16_t crc16Value = 0;
-            uint16_t command;
+    func CommHandle::receivingDaemon() -> Function<void()>
+    {
+        if (this->receiveRing) {
+            this->pipelineActive = true;
+            return [this]() -> void
+            {
+                applyThreadOptions(this->receiveOptions.cpu, this->receiveOptions.realtimePriority);
+                this->receiveRing->reset();
+                Thread reader(&CommHandle::readingDaemon, this);
+                this->parsingDaemon();
+                this->receiveRing->close();
+                reader.join();
+                this->pipelineActive = false;
+            };
+        }
+        this->readerActive = true;
+        return [this]() -> void
+        {
+            applyThreadOptions(this->receiveOptions.cpu, this->receiveOptions.realtimePriority);
+            std::vector<byte_t> buffer(std::max<size_t>(this->receiveOptions.bufferSize, 1));
 
-            Crc8::CrcIterator crc8Iter;
-            Crc16::CrcIterator crc16Iter;
+            // with busy polling the reads return at once and this spins,
+            // yielding keeps it from starving threads sharing the core
+            const bool busyPoll = this->receiveOptions.busyPoll;
+            try {
+                while (this->receivingStateFlag) {
+                    if (this->receiveAvailable(buffer.data(), buffer.size()) <= 0 && busyPoll) {
+                        std::this_thread::yield();
+                    }
+                }
+            } catch (SerialClosedException & exception) {
+                this->receivingStateFlag = false;
+            }
+            this->readerActive = false;
+        };
+    }
 
-            std::vector<byte_t> dataBuffer;
+    func CommHandle::readingDaemon() -> void
+    {
+        ByteRing & ring = *this->receiveRing;
+        const bool busyPoll = this->receiveOptions.busyPoll;
+        struct pollfd watched {};
+        watched.events = POLLIN;
 
-            bool abandonFrame = false;
+        applyThreadOptions(this->receiveOptions.readerCpu, this->receiveOptions.realtimePriority);
 
-            int offset = 0;
+        while (this->receivingStateFlag && !ring.isClosed()) {
+            byte_t* region;
+            size_t free = ring.writable(region);
+            if (free == 0) {
+                ring.waitWritable(10ms);
+                continue;
+            }
 
-            auto readToInt16 = [&offset](uint16_t* dst, byte_t src) {
-                reinterpret_cast<byte_t*>(dst)[offset++] = src;
-            };
+            // bounded wait so a stop request is seen without traffic
+            watched.fd = this->serialPort.getFileDescriptor();
+            if (!busyPoll && ::poll(&watched, 1, 100) == 0) {
+                continue;
+            }
 
-            while (true) {
+            try {
+                int received = this->readPort(region, free);
+                if (received > 0) {
+                    ring.commit((size_t) received);
+                } else if (busyPoll) {
+                    std::this_thread::yield();
+                }
+            } catch (SerialClosedException & exception) {
+                this->receivingStateFlag = false;
+            }
+        }
+        ring.close();
+    }
 
-                if (!this->receivingStateFlag) {
+    func CommHandle::parsingDaemon() -> void
+    {
+        ByteRing & ring = *this->receiveRing;
+        const bool busyPoll = this->receiveOptions.busyPoll;
+        while (true) {
+            const byte_t* region;
+            size_t pending = ring.readable(region);
+            if (pending == 0) {
+                if (ring.isClosed() && ring.size() == 0) {
                     return;
                 }
+                if (busyPoll) {
+                    std::this_thread::yield();
+                } else {
+                    ring.waitReadable(10ms);
+                }
+                continue;
+            }
+            this->processBytes(region, pending);
+            ring.consume(pending);
+        }
+    }
 
-                size_t received = 0;
-
-                this->recvMutex.lock();
-                try {
-                    received = this->serialPort.receive(buffer, BUFFER_SIZE);
-                } catch (SerialClosedException & exception) {
-                    logger::error("Serial device connection closed");
-                    if (this->doReconnect) {
-                        this->reconnect();
-                    } else {
-                        throw serial::SerialClosedException();
-                    }
+    func CommHandle::processBytes(const byte_t* buffer, size_t received) -> void
+    {
+        FrameView frame {};
+        this->decodedAt = LinkStatistics::Clock::now();
+        this->linkStatistics.received(received);
+        this->decoder.setSof(this->sof);
+        this->decoder.feed(buffer, received);
+        ReceivingPath receivingPath;
+        while (this->decoder.next(frame)) {
+            if (this->reliable) {
+                if (frame.commandId == ReliableChannel::ACK_COMMAND) {
+                    this->reliable->acknowledge(frame);
+                } else {
+                    this->reliable->receive(frame);
                 }
-                this->recvMutex.unlock();
+                continue;
+            }
+          #ifdef ABANDON_SAME_FRAME
+            if (frame.sequence == this->lastSequence) {
+                continue;
+            }
+            this->lastSequence = frame.sequence;
+          #endif
+            this->dispatch(frame);
+        }
+        this->linkStatistics.decoded(this->decoder.getStatistics());
+    }
+
+    func CommHandle::setFraming(Framing value) -> void
+    {
+        this->framing = value;
+        this->decoder.setFraming(value);
+    }
+
+    func CommHandle::encodeCobs(const struct iovec* buffers, int count, size_t size) -> Span<byte_t>
+    {
+        thread_local std::vector<byte_t> encoded;
+        encoded.resize(Cobs::maxEncodedSize(size) + 1);
+        size_t length = Cobs::encode(buffers, count, encoded.data());
+        encoded[length++] = Cobs::DELIMITER;
+        return Span<byte_t>(encoded.data(), length);
+    }
+
+    func CommHandle::sendFrame(const struct iovec* buffers, int count, size_t size, Priority priority) -> bool
+    {
+        struct iovec encoded {};
+        if (this->framing == Framing::COBS) {
+            Span<byte_t> bytes = encodeCobs(buffers, count, size);
+            encoded = { const_cast<byte_t*>(bytes.data()), bytes.size() };
+            buffers = &encoded;
+            count = 1;
+            size = bytes.size();
+        }
+        return this->sendEncoded(buffers, count, size, priority);
+    }
 
-                if (received == -1) {
-                    continue;
+    func CommHandle::encodeFrame(const struct iovec* buffers, int count, size_t size, std::vector<byte_t> & output) -> void
+    {
+        output.clear();
+        if (this->framing == Framing::COBS) {
+            Span<byte_t> bytes = encodeCobs(buffers, count, size);
+            output.insert(output.end(), bytes.data(), bytes.data() + bytes.size());
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            const auto* bytes = static_cast<const byte_t*>(buffers[i].iov_base);
+            output.insert(output.end(), bytes, bytes + buffers[i].iov_len);
+        }
+    }
+
+    func CommHandle::sendEncoded(const struct iovec* buffers, int count, size_t size, Priority priority) -> bool
+    {
+        if (this->prioritySender) {
+            return this->prioritySender->push(priority, buffers, count);
+        }
+        if (this->sendQueue) {
+            return this->sendQueue->emplace(size, [&](byte_t* buffer) {
+                for (int i = 0; i < count; i++) {
+                    std::memcpy(buffer, buffers[i].iov_base, buffers[i].iov_len);
+                    buffer += buffers[i].iov_len;
                 }
+            });
+        }
+        if (this->coalescer) {
+            if (count == 1) {
+                return this->coalescer->append(buffers[0].iov_base, size);
+            }
+            thread_local std::vector<byte_t> gathered;
+            gathered.clear();
+            for (int i = 0; i < count; i++) {
+                const auto* bytes = static_cast<const byte_t*>(buffers[i].iov_base);
+                gathered.insert(gathered.end(), bytes, bytes + buffers[i].iov_len);
+            }
+            return this->coalescer->append(gathered.data(), size);
+        }
+        return this->writeDirect(buffers, count) == (int) size;
+    }
 
-                for (int i = 0; i < received; i++) {
-
-                    byte_t currentByte = buffer[i];
-
-                    switch (state) {
-
-                        case SOF:
-                        {
-                            if (currentByte == this->sof) {
-                                state = DLEN;
-                                offset = 0;
-                                crc8Iter  = Crc8::iterator();
-                                crc16Iter = Crc16::iterator();
-                            }
-                        }
-                        break;
-
-                        case DLEN:
-                        {
-                            readToInt16(&dataLength, currentByte);
-                            if (offset == 2) {
-                                offset = 0;
-                                state = SEQ;
-                            }
-                        }
-                        break;
-
-                        case SEQ:
-                        {
-                          #ifdef ABANDON_SAME_FRAME
-                            if (currentByte == sequence) {
-                                abandonFrame = true;
-                            } else {
-                                sequence = currentByte;
-                            }
-                          #endif
-                            state = CRC8;
-                        }
-                        break;
-
-                        case CRC8:
-                        {
-                            if (crc8Iter.getValue() == currentByte) {
-                                state = CMD;
-                            } else {
-                                state = SOF;
-                            }
-                        }
-                        break;
-
-                        case CMD:
-                        {
-                            readToInt16(&command, currentByte);
-                            if (offset == 2) {
-                                offset = 0;
-                                state = DATA;
-                            }
-                        }
-                        break;
-
-                        case DATA:
-                        {
-                            if (++offset <= dataLength) {
-                                dataBuffer.emplace_back(currentByte);
-                            }
-                            if (offset == dataLength){
-                                offset = 0;
-                                state = CRC16;
-                                crc16Iter.computeNext(currentByte);
-                            }
-                        }
-                        break;
-
-                        case CRC16:
-                        {
-                            readToInt16(&crc16Value, currentByte);
-                            if (offset == 2) {
-                                offset = 0;
-                                state = SOF;
-                                if (!abandonFrame && crc16Iter.getValue() == crc16Value) {
-                                    if (subscribers.find(command) != subscribers.end()) {
-                                        logger::debug("Calling subscriber callback for command id ", command);
-                                        subscribers[command]->receive(dataBuffer.data());
-                                    } else {
-                                        logger::warning("No subscriber for command id ", command);
-                                    }
-                                }
-                                crc16Value = 0;
-                                dataBuffer.clear();
-                            }
-                        }
-                        break;
-
-                    }   // end switch
-
-                    if (state != SOF && state != CRC16) {
-                        crc8Iter.computeNext(currentByte);
-                        crc16Iter.computeNext(currentByte);
-                    }
+    func CommHandle::sendPayload(uint16_t commandId, const void* data, size_t length, Priority priority) -> bool
+    {
+        if (this->aggregator && priority == Priority::NORMAL) {
+            return this->aggregator->append(commandId, data, length);
+        }
+        return this->framePayload(commandId, data, length, priority);
+    }
+
+    func CommHandle::framePayload(uint16_t commandId, const void* data, size_t length, Priority priority) -> bool
+    {
+        size_t slice = this->prioritySender ? this->prioritySender->slice() : SIZE_MAX;
+        size_t overhead = DynamicCommandFrame::HEADER_SIZE + DynamicCommandFrame::TRAILER_SIZE;
+        if (priority == Priority::HIGH || length + overhead <= slice) {
+            return this->sendDynamic(commandId, data, length, priority);
+        }
+
+        // every fragment fits a slice, COBS included
+        overhead += Fragment::HEADER_SIZE;
+        if (this->framing == Framing::COBS) {
+            overhead += slice / 254 + 2;
+        }
+        size_t pieceSize = slice - overhead;
+        const auto* bytes = static_cast<const byte_t*>(data);
+        thread_local std::vector<byte_t> piece;
+        PrioritySender::Transfer transfer;
+        std::unique_lock<Mutex> lock(this->fragmentMutex, std::defer_lock);
+        if (this->reliable) {
+            // each piece is kept and numbered on its own, no other payload's pieces in between
+            lock.lock();
+        } else {
+            transfer = this->prioritySender->transfer();
+        }
+
+        bool sent = true;
+        for (size_t offset = 0; offset < length; offset += pieceSize) {
+            size_t pieceLength = std::min(pieceSize, length - offset);
+            piece.resize(Fragment::HEADER_SIZE + pieceLength);
+            Fragment::writeHeader(piece.data(), Fragment::Header { commandId, (uint16_t) offset, (uint16_t) length });
+            std::memcpy(piece.data() + Fragment::HEADER_SIZE, bytes + offset, pieceLength);
+
+            if (this->reliable) {
+                sent = this->sendDynamic(Fragment::COMMAND, piece.data(), piece.size(), priority) && sent;
+                continue;
+            }
+            DynamicCommandFrame frame(Fragment::COMMAND, piece.data(), piece.size(), this->sof, this->nextSequence());
+            struct iovec buffers[3];
+            frame.buffers(buffers);
+            if (this->framing == Framing::COBS) {
+                Span<byte_t> encoded = encodeCobs(buffers, 3, frame.frameSize());
+                struct iovec buffer { const_cast<byte_t*>(encoded.data()), encoded.size() };
+                transfer.append(&buffer, 1);
+            } else {
+                transfer.append(buffers, 3);
+            }
+        }
+        return this->reliable ? sent : this->prioritySender->push(priority, std::move(transfer));
+    }
+
+    func CommHandle::sendDynamic(uint16_t commandId, const void* data, size_t length, Priority priority) -> bool
+    {
+        if (this->reliable) {
+            // subscribers must not wait for acknowledgements that only reach the handle once they return
+            bool mayWait = !onReceivingPath && !CallbackExecutor::onWorkerThread();
+            return this->reliable->send(commandId, data, length, priority, mayWait);
+        }
+        DynamicCommandFrame frame(commandId, data, length, this->sof, this->nextSequence());
+        struct iovec buffers[3];
+        frame.buffers(buffers);
+        return this->sendFrame(buffers, 3, frame.frameSize(), priority);
+    }
+
+    func CommHandle::publishDelta(DeltaChannel & channel, uint16_t commandId, const void* data, Priority priority) -> bool
+    {
+        std::lock_guard<Mutex> lock(channel.mutex);
+        Span<byte_t> payload = channel.encoder.encode(static_cast<const byte_t*>(data));
+        if (channel.encoder.wasKeyframe()) {
+            channel.keyframesSent.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            channel.deltasSent.fetch_add(1, std::memory_order_relaxed);
+            channel.bytesSaved.fetch_add(channel.decoder.size() - payload.size(), std::memory_order_relaxed);
+        }
+        bool sent = this->sendPayload(commandId, payload.data(), payload.size(), priority);
+        if (!sent) {
+            // the receiver's base is unknown now
+            channel.encoder.restart();
+        }
+        return sent;
+    }
+
+    func CommHandle::deltaStatistics(uint16_t commandId) const -> DeltaStatistics
+    {
+        auto found = this->deltaChannels.find(commandId);
+        if (found == this->deltaChannels.end()) {
+            return DeltaStatistics {};
+        }
+        const DeltaChannel & channel = *found->second;
+        return DeltaStatistics {
+            channel.keyframesSent.load(std::memory_order_relaxed),
+            channel.deltasSent.load(std::memory_order_relaxed),
+            channel.bytesSaved.load(std::memory_order_relaxed),
+            channel.keyframesReceived.load(std::memory_order_relaxed),
+            channel.deltasReceived.load(std::memory_order_relaxed),
+            channel.dropped.load(std::memory_order_relaxed),
+        };
+    }
+
+    func CommHandle::dispatch(const FrameView & frame) -> void
+    {
+        LinkStatistics::Command & statistics = this->linkStatistics.command(frame.commandId);
+        statistics.frames.fetch_add(1, std::memory_order_relaxed);
+        statistics.bytes.fetch_add(frame.dataLength, std::memory_order_relaxed);
+
+        if (frame.commandId == Superframe::COMMAND) {
+            this->unpack(frame, statistics);
+            return;
+        }
+        if (frame.commandId == Fragment::COMMAND) {
+            this->reassemble(frame, statistics);
+            return;
+        }
+
+        DeltaChannel* channel = this->findDelta(frame.commandId);
+        if (channel == nullptr) {
+            this->deliver(frame, statistics);
+            return;
+        }
+
+        switch (channel->decoder.decode(frame.data, frame.dataLength)) {
+            case DeltaDecoder::Result::KEYFRAME:
+                channel->keyframesReceived.fetch_add(1, std::memory_order_relaxed);
+                this->deliver(frame, statistics);
+                break;
+
+            case DeltaDecoder::Result::DELTA:
+            {
+                channel->deltasReceived.fetch_add(1, std::memory_order_relaxed);
+                // the rebuilt value gets a buffer of its own, it may be kept or queued
+                FrameBuffer value = this->framePool->acquire(channel->decoder.size());
+                std::memcpy(value.mutableData(), channel->decoder.value(), channel->decoder.size());
+                value.setHeader(frame.commandId, frame.sequence);
+                FrameView rebuilt { frame.commandId, frame.sequence, (uint16_t) value.size(), value.data(), &value };
+                this->deliver(rebuilt, statistics);
+            }
+            break;
+
+            default:
+            {
+                static logger::RateLimiter limiter;
+                channel->dropped.fetch_add(1, std::memory_order_relaxed);
+                logger::warning(limiter, "Delta for command id ", frame.commandId, " dropped, waiting for a keyframe");
+            }
+            break;
+        }
+    }
 
-                }   // end for
+    func CommHandle::receiveResponse(void* target, const FrameView & frame) -> void
+    {
+        static_cast<CallTable*>(target)->respond(frame);
+    }
+
+    func CommHandle::waitFrame(uint16_t commandId, const FrameWaiters::Waiter & waiter) -> bool
+    {
+        auto found = this->frameWaiters.find(commandId);
+        if (found == this->frameWaiters.end()) {
+            return false;
+        }
+        found->second->add(waiter);
+        return true;
+    }
 
-            }   // end while
+    func CommHandle::whenSendable(const ReliableChannel::RoomWaiter & waiter) -> bool
+    {
+        return !this->reliable || this->reliable->whenRoom(waiter);
+    }
 
-        };  // end lambda
+    func CommHandle::callStatistics() const -> CallTable::Statistics
+    {
+        if (this->callTable) {
+            return this->callTable->getStatistics();
+        }
+        return CallTable::Statistics {};
+    }
+
+    func CommHandle::unpack(const FrameView & frame, LinkStatistics::Command & statistics) -> void
+    {
+        Superframe::Reader reader(frame.data, frame.dataLength);
+        uint16_t commandId;
+        const byte_t* payload;
+        size_t length;
+        while (reader.next(commandId, payload, length)) {
+            if (commandId == Superframe::COMMAND) {
+                continue;  // never nested
+            }
+            // every record gets a buffer of its own, it may be kept or queued
+            FrameBuffer record = this->framePool->acquire(length);
+            std::memcpy(record.mutableData(), payload, length);
+            record.setHeader(commandId, frame.sequence);
+            this->dispatch(FrameView { commandId, frame.sequence, (uint16_t) length, record.data(), &record });
+        }
+        if (reader.failed()) {
+            static logger::RateLimiter limiter;
+            statistics.badLengthFrames.fetch_add(1, std::memory_order_relaxed);
+            logger::warning(limiter, "Superframe record runs past the end of the frame");
+        }
+    }
 
-    } // end function
+    func CommHandle::reassemble(const FrameView & frame, LinkStatistics::Command & statistics) -> void
+    {
+        Fragment::Header header {};
+        if (!Fragment::readHeader(frame.data, frame.dataLength, header) || header.commandId == Fragment::COMMAND) {
+            static logger::RateLimiter limiter;
+            statistics.badLengthFrames.fetch_add(1, std::memory_order_relaxed);
+            logger::warning(limiter, "Malformed fragment dropped");
+            return;
+        }
+
+        size_t length = frame.dataLength - Fragment::HEADER_SIZE;
+        Reassembly & reassembly = this->reassemblies[header.commandId];
+        if (header.offset == 0) {
+            if (reassembly.received != 0) {
+                this->linkStatistics.command(header.commandId).incomplete.fetch_add(1, std::memory_order_relaxed);
+            }
+            reassembly.buffer = this->framePool->acquire(header.total);
+            reassembly.received = 0;
+        } else if (reassembly.received != header.offset || reassembly.buffer.size() != header.total) {
+            if (reassembly.received != 0) {
+                static logger::RateLimiter limiter;
+                this->linkStatistics.command(header.commandId).incomplete.fetch_add(1, std::memory_order_relaxed);
+                logger::warning(limiter, "Fragment of command id ", header.commandId, " missing, payload dropped");
+                reassembly.buffer = FrameBuffer();
+                reassembly.received = 0;
+            }
+            return;
+        }
+
+        std::memcpy(reassembly.buffer.mutableData() + header.offset, frame.data + Fragment::HEADER_SIZE, length);
+        reassembly.received += length;
+        if (reassembly.received < header.total) {
+            return;
+        }
+
+        FrameBuffer payload = std::move(reassembly.buffer);
+        reassembly.buffer = FrameBuffer();
+        reassembly.received = 0;
+        payload.setHeader(header.commandId, frame.sequence);
+        this->dispatch(FrameView { header.commandId, frame.sequence, header.total, payload.data(), &payload });
+    }
+
+    func CommHandle::deliver(const FrameView & frame, LinkStatistics::Command & statistics) -> void
+    {
+        using Clock = LinkStatistics::Clock;
+
+        if (this->routes != nullptr) {
+            Clock::time_point start = Clock::now();
+            RouteResult routed = this->routes(frame);
+            if (routed == RouteResult::DELIVERED) {
+                statistics.called(this->decodedAt, start, Clock::now());
+                return;
+            }
+            if (routed == RouteResult::TOO_SHORT) {
+                static logger::RateLimiter limiter;
+                statistics.shortFrames.fetch_add(1, std::memory_order_relaxed);
+                logger::warning(limiter, "Frame too short for command id ", frame.commandId, ", DLEN ", frame.dataLength);
+                return;
+            }
+        }
+        const DispatchTable::Entry & entry = this->dispatchTable.find(frame.commandId);
+        if (entry.invoke == nullptr) {
+            static logger::RateLimiter limiter;
+            statistics.unhandled.fetch_add(1, std::memory_order_relaxed);
+            logger::warning(limiter, "No subscriber for command id ", frame.commandId);
+        } else if (frame.dataLength < entry.dataLength) {
+            static logger::RateLimiter limiter;
+            statistics.shortFrames.fetch_add(1, std::memory_order_relaxed);
+            logger::warning(limiter, "Frame too short for command id ", frame.commandId, ", DLEN ", frame.dataLength);
+        } else if (frame.dataLength > entry.maxDataLength || (entry.stride > 1 && frame.dataLength % entry.stride != 0)) {
+            static logger::RateLimiter limiter;
+            statistics.badLengthFrames.fetch_add(1, std::memory_order_relaxed);
+            logger::warning(limiter, "Frame length does not fit command id ", frame.commandId, ", DLEN ", frame.dataLength);
+        } else if (this->executor && frame.buffer != nullptr) {
+            this->executor->submit(entry, *frame.buffer, this->decodedAt);
+        } else {
+            logger::debug("Calling subscriber callback for command id ", frame.commandId);
+            Clock::time_point start = Clock::now();
+            entry.invoke(entry.target, frame);
+            statistics.called(this->decodedAt, start, Clock::now());
+        }
+    }
 
-} // end namespace
\ No newline at end of file
+} // end namespace
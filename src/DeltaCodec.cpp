@@ -0,0 +1,159 @@
+#include "serial/command/DeltaCodec.hpp"
+
+#include <cstring>
+
+#define func auto
+
+namespace serial::command
+{
+    using Crc8 = CommandFrameUtils::Crc8;
+
+    static constexpr size_t HEADER_SIZE = DeltaEncoder::HEADER_SIZE;
+
+    // unchanged bytes inside a run cost one byte each, a new run two
+    static constexpr size_t MAX_GAP = 2;
+
+    DeltaEncoder::DeltaEncoder(size_t size, const DeltaOptions & options)
+        : options(options), last(size), delta(size)
+    {
+    }
+
+    func DeltaEncoder::encodeRuns(const byte_t* value) -> bool
+    {
+        const size_t size = this->last.size();
+        const byte_t* previous = this->last.data();
+        byte_t* output = this->delta.data();
+        size_t used = HEADER_SIZE;
+        size_t position = 0;
+
+        while (true) {
+            size_t start = position;
+            // equal words are skipped eight bytes at a time
+            while (position + 8 <= size && std::memcmp(value + position, previous + position, 8) == 0) {
+                position += 8;
+            }
+            while (position < size && value[position] == previous[position]) {
+                position++;
+            }
+            if (position == size) {
+                break;
+            }
+
+            size_t skip = position - start;
+            while (skip > UINT8_MAX) {
+                if (used + 2 >= size) {
+                    return false;
+                }
+                output[used++] = UINT8_MAX;
+                output[used++] = 0;
+                skip -= UINT8_MAX;
+            }
+
+            size_t end = position;   // past the last changed byte of the run
+            for (size_t scan = position; scan < size && scan - position < UINT8_MAX; scan++) {
+                if (value[scan] != previous[scan]) {
+                    end = scan + 1;
+                } else if (scan - end >= MAX_GAP) {
+                    break;
+                }
+            }
+            size_t count = end - position;
+            if (used + 2 + count >= size) {
+                return false;
+            }
+            output[used++] = (byte_t) skip;
+            output[used++] = (byte_t) count;
+            for (size_t i = position; i < end; i++) {
+                output[used++] = value[i] ^ previous[i];
+            }
+            position = end;
+        }
+
+        // a value too short for anything but the header, or unchanged
+        // and no longer than it, would be taken for a keyframe
+        if (used >= size) {
+            return false;
+        }
+        output[0] = (byte_t) (this->counter + 1);
+        output[1] = this->keyframeCrc;
+        this->delta.resize(used);
+        return true;
+    }
+
+    func DeltaEncoder::encode(const byte_t* value) -> Span<byte_t>
+    {
+        const size_t size = this->last.size();
+        Clock::time_point now = Clock::now();
+        bool due = !this->hasLast
+            || this->deltas >= this->options.keyframeInterval
+            || now - this->lastKeyframe >= this->options.keyframePeriod;
+
+        this->delta.resize(size);
+        if (!due && this->encodeRuns(value)) {
+            this->counter++;
+            this->deltas++;
+            this->keyframe = false;
+            std::memcpy(this->last.data(), value, size);
+            return Span<byte_t>(this->delta.data(), this->delta.size());
+        }
+
+        this->counter = 0;
+        this->deltas = 0;
+        this->keyframe = true;
+        this->hasLast = true;
+        this->lastKeyframe = now;
+        std::memcpy(this->last.data(), value, size);
+        this->keyframeCrc = (uint8_t) Crc8::compute(this->last.data(), size);
+        return Span<byte_t>(this->last.data(), size);
+    }
+
+    DeltaDecoder::DeltaDecoder(size_t size) : current(size)
+    {
+    }
+
+    func DeltaDecoder::decode(const byte_t* payload, size_t length) -> Result
+    {
+        const size_t size = this->current.size();
+        if (length == size) {
+            std::memcpy(this->current.data(), payload, size);
+            this->valid = true;
+            this->counter = 0;
+            this->keyframeCrc = (uint8_t) Crc8::compute(payload, size);
+            return Result::KEYFRAME;
+        }
+        if (length < HEADER_SIZE || length > size) {
+            return Result::MALFORMED;
+        }
+        if (!this->valid || payload[0] != (uint8_t) (this->counter + 1) || payload[1] != this->keyframeCrc) {
+            this->valid = false;
+            return Result::STALE;
+        }
+
+        // check the runs before touching the value, a bad delta leaves it intact
+        size_t position = 0;
+        for (size_t at = HEADER_SIZE; at < length; ) {
+            if (at + 2 > length || at + 2 + payload[at + 1] > length) {
+                return Result::MALFORMED;
+            }
+            position += payload[at] + payload[at + 1];
+            if (position > size) {
+                return Result::MALFORMED;
+            }
+            at += 2 + payload[at + 1];
+        }
+
+        position = 0;
+        byte_t* value = this->current.data();
+        for (size_t at = HEADER_SIZE; at < length; ) {
+            position += payload[at];
+            size_t count = payload[at + 1];
+            for (size_t i = 0; i < count; i++) {
+                value[position + i] ^= payload[at + 2 + i];
+            }
+            position += count;
+            at += 2 + count;
+        }
+        this->counter++;
+        return Result::DELTA;
+    }
+}
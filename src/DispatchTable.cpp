@@ -0,0 +1,32 @@
+#include "serial/command/DispatchTable.hpp"
+
+#define func auto
+
+namespace serial::command
+{
+    DispatchTable::Page DispatchTable::emptyPage {};
+
+    DispatchTable::DispatchTable()
+    {
+        this->pages.fill(&emptyPage);
+    }
+
+    func DispatchTable::set(uint16_t commandId, Invoker invoke, void* target, uint16_t dataLength,
+                            uint16_t maxDataLength, uint16_t stride) -> void
+    {
+        Page* & page = this->pages[commandId >> 8];
+        if (page == &emptyPage) {
+            this->allocated.emplace_back(std::make_unique<Page>());
+            page = this->allocated.back().get();
+        }
+        (*page)[commandId & 0xFF] = Entry { invoke, target, dataLength, maxDataLength, stride };
+    }
+
+    func DispatchTable::erase(uint16_t commandId) -> void
+    {
+        Page* page = this->pages[commandId >> 8];
+        if (page != &emptyPage) {
+            (*page)[commandId & 0xFF] = Entry {};
+        }
+    }
+}
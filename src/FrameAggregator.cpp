@@ -0,0 +1,134 @@
+#include "serial/FrameAggregator.hpp"
+#include "serial/utils/Logger.hpp"
+
+#include <cstring>
+
+#define func auto
+
+namespace serial
+{
+    namespace Superframe = command::Superframe;
+
+    FrameAggregator::FrameAggregator(Sink sink, size_t maxBytes, Duration maxDelay)
+        : sink(std::move(sink)), maxBytes(maxBytes < UINT16_MAX ? maxBytes : UINT16_MAX), maxDelay(maxDelay)
+    {
+        this->buffer.reserve(this->maxBytes);
+        this->flushThread = std::thread(&FrameAggregator::flushDaemon, this);
+    }
+
+    FrameAggregator::~FrameAggregator()
+    {
+        {
+            Lock lock(this->mutex);
+            this->running = false;
+            try {
+                this->flushLocked();
+            } catch (std::exception & exception) {
+                // the port is gone, an exception must not leave a destructor
+                static logger::RateLimiter limiter;
+                logger::warning(limiter, "Aggregated frames dropped at teardown: ", exception.what());
+            }
+        }
+        this->wakeup.notify_all();
+        if (this->flushThread.joinable()) {
+            this->flushThread.join();
+        }
+    }
+
+    func FrameAggregator::append(uint16_t commandId, const void* data, size_t length) -> bool
+    {
+        const auto* bytes = static_cast<const byte_t*>(data);
+        size_t recordSize = Superframe::recordHeaderSize(length) + length;
+        Lock lock(this->mutex);
+        this->statistics.records++;
+
+        if (length > Superframe::MAX_RECORD_LENGTH || recordSize > this->maxBytes) {
+            // pending records go first, order is kept
+            bool flushed = this->flushLocked();
+            this->statistics.singles++;
+            return this->sink(commandId, bytes, length) && flushed;
+        }
+
+        bool flushed = true;
+        if (this->buffer.size() + recordSize > this->maxBytes) {
+            flushed = this->flushLocked();
+        }
+
+        bool wasEmpty = this->buffer.empty();
+        size_t at = this->buffer.size();
+        this->buffer.resize(at + recordSize);
+        size_t header = Superframe::writeRecordHeader(this->buffer.data() + at, commandId, length);
+        std::memcpy(this->buffer.data() + at + header, bytes, length);
+        this->records++;
+
+        if (this->buffer.size() == this->maxBytes) {
+            return this->flushLocked() && flushed;
+        }
+        if (wasEmpty) {
+            this->deadline = Clock::now() + this->maxDelay;
+            lock.unlock();
+            this->wakeup.notify_one();
+        }
+        return flushed;
+    }
+
+    func FrameAggregator::flush() -> bool
+    {
+        Lock lock(this->mutex);
+        return this->flushLocked();
+    }
+
+    func FrameAggregator::getStatistics() -> Statistics
+    {
+        Lock lock(this->mutex);
+        return this->statistics;
+    }
+
+    func FrameAggregator::flushLocked() -> bool
+    {
+        if (this->records == 0) {
+            return true;
+        }
+        bool sent;
+        try {
+            if (this->records == 1) {
+                // no one to share the header with, send it as it is
+                uint16_t commandId;
+                const byte_t* payload;
+                size_t length;
+                Superframe::Reader reader(this->buffer.data(), this->buffer.size());
+                reader.next(commandId, payload, length);
+                this->statistics.singles++;
+                sent = this->sink(commandId, payload, length);
+            } else {
+                this->statistics.superframes++;
+                sent = this->sink(Superframe::COMMAND, this->buffer.data(), this->buffer.size());
+            }
+        } catch (...) {
+            this->buffer.clear();
+            this->records = 0;
+            throw;
+        }
+        this->buffer.clear();
+        this->records = 0;
+        return sent;
+    }
+
+    func FrameAggregator::flushDaemon() -> void
+    {
+        Lock lock(this->mutex);
+        while (this->running) {
+            if (this->buffer.empty()) {
+                this->wakeup.wait(lock);
+            } else if (Clock::now() >= this->deadline) {
+                try {
+                    this->flushLocked();
+                } catch (std::exception &) {
+                    // the sink already reported it, the next write will surface it again
+                }
+            } else {
+                this->wakeup.wait_until(lock, this->deadline);
+            }
+        }
+    }
+}
@@ -0,0 +1,301 @@
+#include "serial/command/FrameDecoder.hpp"
+
+#include <cstring>
+
+#define func auto
+
+namespace serial::command
+{
+    using Crc8  = CommandFrameUtils::Crc8;
+    using Crc16 = CommandFrameUtils::Crc16;
+
+    static inline func readUint16(const byte_t* data) -> uint16_t
+    {
+        return (uint16_t) (data[0] | (data[1] << 8));
+    }
+
+    FrameDecoder::FrameDecoder(byte_t sof, size_t maxDataLength, FramePool* pool)
+        : sof(sof), maxDataLength(maxDataLength), pool(pool)
+    {
+        this->carry.reserve(HEADER_SIZE + 256 + TRAILER_SIZE);
+    }
+
+    func FrameDecoder::feed(const byte_t* data, size_t size) -> void
+    {
+        this->input = data;
+        this->inputSize = size;
+    }
+
+    func FrameDecoder::reset() -> void
+    {
+        this->carry.clear();
+        this->carryConsumed = 0;
+        this->input = nullptr;
+        this->inputSize = 0;
+        this->current = FrameBuffer();
+        this->overflowed = false;
+    }
+
+    func FrameDecoder::frameSize(const byte_t* header) -> size_t
+    {
+        return HEADER_SIZE + readUint16(header + 1) + TRAILER_SIZE;
+    }
+
+    func FrameDecoder::fillView(const byte_t* frameStart, FrameView & frame) -> void
+    {
+        frame.dataLength = readUint16(frameStart + 1);
+        frame.sequence   = frameStart[3];
+        frame.commandId  = readUint16(frameStart + 5);
+        frame.data       = frameStart + HEADER_SIZE;
+        frame.buffer     = nullptr;
+        this->synced     = true;
+
+        if (this->pool != nullptr) {
+            this->current = this->pool->acquire(frame.dataLength);
+            this->current.setHeader(frame.commandId, frame.sequence);
+            std::memcpy(this->current.mutableData(), frame.data, frame.dataLength);
+            frame.data   = this->current.data();
+            frame.buffer = &this->current;
+        }
+    }
+
+    func FrameDecoder::headerValid(const byte_t* header) -> bool
+    {
+        if (Crc8::compute(header, 4) != header[4]) {
+            this->statistics.crc8Failures++;
+            return false;
+        }
+        if (readUint16(header + 1) > this->maxDataLength) {
+            this->statistics.oversizedFrames++;
+            return false;
+        }
+        return true;
+    }
+
+    func FrameDecoder::discard(size_t count) -> void
+    {
+        if (count > 0 && this->synced) {
+            this->statistics.resyncs++;
+            this->synced = false;
+        }
+        this->statistics.bytesDiscarded += count;
+    }
+
+    static inline func crc16Matches(const byte_t* frameStart, size_t size) -> bool
+    {
+        size_t covered = size - FrameDecoder::TRAILER_SIZE;
+        return Crc16::compute(frameStart, covered) == readUint16(frameStart + covered);
+    }
+
+    func FrameDecoder::next(FrameView & frame) -> bool
+    {
+        if (this->framing == Framing::COBS) {
+            return this->nextCobs(frame);
+        }
+        if (this->carryConsumed > 0) {
+            // bytes behind a frame completed in the carry buffer still need a look
+            this->carry.erase(this->carry.begin(), this->carry.begin() + (long) this->carryConsumed);
+            this->carryConsumed = 0;
+            this->dropCarryToSof(0);
+        }
+
+        if (this->nextFromCarry(frame)) {
+            return true;
+        }
+        if (!this->carry.empty()) {
+            return false;  // the span ended inside the carried frame
+        }
+        return this->nextFromInput(frame);
+    }
+
+    func FrameDecoder::dropCarryToSof(size_t from) -> void
+    {
+        size_t size = this->carry.size();
+        const void* found = from < size ? std::memchr(this->carry.data() + from, this->sof, size - from) : nullptr;
+        if (found == nullptr) {
+            this->discard(size);
+            this->carry.clear();
+        } else {
+            size_t offset = static_cast<const byte_t*>(found) - this->carry.data();
+            this->discard(offset);
+            this->carry.erase(this->carry.begin(), this->carry.begin() + (long) offset);
+        }
+    }
+
+    func FrameDecoder::takeInput(size_t wanted) -> void
+    {
+        size_t taken = wanted < this->inputSize ? wanted : this->inputSize;
+        this->carry.insert(this->carry.end(), this->input, this->input + taken);
+        this->input += taken;
+        this->inputSize -= taken;
+    }
+
+    func FrameDecoder::nextFromCarry(FrameView & frame) -> bool
+    {
+        while (!this->carry.empty()) {
+
+            if (this->carry.size() < HEADER_SIZE) {
+                this->takeInput(HEADER_SIZE - this->carry.size());
+                if (this->carry.size() < HEADER_SIZE) {
+                    return false;
+                }
+            }
+
+            if (!this->headerValid(this->carry.data())) {
+                this->dropCarryToSof(1);
+                continue;
+            }
+
+            size_t size = frameSize(this->carry.data());
+            if (this->carry.size() < size) {
+                this->takeInput(size - this->carry.size());
+                if (this->carry.size() < size) {
+                    return false;
+                }
+            }
+
+            if (!crc16Matches(this->carry.data(), size)) {
+                this->statistics.crc16Failures++;
+                this->dropCarryToSof(1);
+                continue;
+            }
+
+            this->fillView(this->carry.data(), frame);
+            this->carryConsumed = size;
+            this->statistics.frames++;
+            return true;
+        }
+        return false;
+    }
+
+    func FrameDecoder::nextFromInput(FrameView & frame) -> bool
+    {
+        while (this->inputSize > 0) {
+
+            const auto* start = static_cast<const byte_t*>(std::memchr(this->input, this->sof, this->inputSize));
+            if (start == nullptr) {
+                this->discard(this->inputSize);
+                this->input += this->inputSize;
+                this->inputSize = 0;
+                return false;
+            }
+
+            size_t skipped = start - this->input;
+            this->discard(skipped);
+            this->input = start;
+            this->inputSize -= skipped;
+
+            if (this->inputSize < HEADER_SIZE) {
+                this->takeInput(this->inputSize);
+                return false;
+            }
+
+            if (!this->headerValid(this->input)) {
+                this->discard(1);
+                this->input++;
+                this->inputSize--;
+                continue;
+            }
+
+            size_t size = frameSize(this->input);
+            if (this->inputSize < size) {
+                // the frame continues in the next span
+                this->takeInput(this->inputSize);
+                return false;
+            }
+
+            if (!crc16Matches(this->input, size)) {
+                this->statistics.crc16Failures++;
+                this->discard(1);
+                this->input++;
+                this->inputSize--;
+                continue;
+            }
+
+            this->fillView(this->input, frame);
+            this->input += size;
+            this->inputSize -= size;
+            this->statistics.frames++;
+            return true;
+        }
+        return false;
+    }
+
+    func FrameDecoder::nextCobs(FrameView & frame) -> bool
+    {
+        const size_t maxEncoded = Cobs::maxEncodedSize(HEADER_SIZE + this->maxDataLength + TRAILER_SIZE);
+
+        while (this->inputSize > 0) {
+            const auto* delimiter = static_cast<const byte_t*>(std::memchr(this->input, Cobs::DELIMITER, this->inputSize));
+            if (delimiter == nullptr) {
+                // the frame continues in the next span
+                if (this->overflowed || this->carry.size() + this->inputSize > maxEncoded) {
+                    if (!this->overflowed) {
+                        this->statistics.oversizedFrames++;
+                    }
+                    this->discard(this->carry.size() + this->inputSize);
+                    this->carry.clear();
+                    this->overflowed = true;
+                } else {
+                    this->carry.insert(this->carry.end(), this->input, this->input + this->inputSize);
+                }
+                this->input += this->inputSize;
+                this->inputSize = 0;
+                return false;
+            }
+
+            size_t length = delimiter - this->input;
+            const byte_t* encoded = this->input;
+            size_t size = length;
+            this->input = delimiter + 1;
+            this->inputSize -= length + 1;
+
+            if (this->overflowed) {
+                this->discard(length + 1);
+                this->overflowed = false;
+                continue;
+            }
+            if (!this->carry.empty()) {
+                this->carry.insert(this->carry.end(), encoded, encoded + length);
+                encoded = this->carry.data();
+                size = this->carry.size();
+            }
+
+            bool accepted = this->acceptCobs(encoded, size, frame);
+            this->carry.clear();
+            if (accepted) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    func FrameDecoder::acceptCobs(const byte_t* encoded, size_t size, FrameView & frame) -> bool
+    {
+        if (size == 0) {
+            return false;  // delimiters back to back
+        }
+        this->decoded.resize(size);
+        size_t length = Cobs::decode(encoded, size, this->decoded.data());
+        const byte_t* frameStart = this->decoded.data();
+
+        if (length == SIZE_MAX || length < HEADER_SIZE + TRAILER_SIZE || frameStart[0] != this->sof) {
+            this->discard(size + 1);
+            return false;
+        }
+        if (!this->headerValid(frameStart)) {
+            this->discard(size + 1);
+            return false;
+        }
+        // a frame cut short or run together with another fails here
+        if (frameSize(frameStart) != length || !crc16Matches(frameStart, length)) {
+            this->statistics.crc16Failures++;
+            this->discard(size + 1);
+            return false;
+        }
+
+        this->fillView(frameStart, frame);
+        this->statistics.frames++;
+        return true;
+    }
+}
@@ -0,0 +1,142 @@
+#include "serial/command/FramePool.hpp"
+
+#include <new>
+
+#define func auto
+
+namespace serial::command
+{
+    using Slab = FrameBuffer::Slab;
+
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    struct FramePool::Storage
+    {
+        std::atomic<size_t> users { 1 };  // the pool and every slab handed out
+        byte_t* memory = nullptr;
+        size_t slabSize = 0;
+        size_t stride = 0;
+        size_t count = 0;
+
+        std::atomic<uint64_t> head { EMPTY };  // first free slab, ABA tag in the high half
+
+        std::atomic<uint64_t> acquired { 0 };
+        std::atomic<uint64_t> oversized { 0 };
+        std::atomic<uint64_t> exhausted { 0 };
+
+        inline Slab* slabAt(uint32_t index) const
+        {
+            return reinterpret_cast<Slab*>(this->memory + index * this->stride);
+        }
+
+        Slab* pop()
+        {
+            uint64_t current = this->head.load(std::memory_order_acquire);
+            while (true) {
+                auto index = (uint32_t) current;
+                if (index == EMPTY) {
+                    return nullptr;
+                }
+                Slab* slab = this->slabAt(index);
+                uint64_t replacement = (((current >> 32) + 1) << 32) | slab->next.load(std::memory_order_relaxed);
+                if (this->head.compare_exchange_weak(current, replacement, std::memory_order_acquire)) {
+                    return slab;
+                }
+            }
+        }
+
+        void push(Slab* slab)
+        {
+            uint64_t current = this->head.load(std::memory_order_relaxed);
+            uint64_t replacement;
+            do {
+                slab->next.store((uint32_t) current, std::memory_order_relaxed);
+                replacement = (((current >> 32) + 1) << 32) | slab->index;
+            } while (!this->head.compare_exchange_weak(current, replacement, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        void unreference()
+        {
+            if (this->users.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                for (size_t i = 0; i < this->count; i++) {
+                    this->slabAt(i)->~Slab();
+                }
+                ::operator delete(this->memory, std::align_val_t(FrameBuffer::ALIGNMENT));
+                delete this;
+            }
+        }
+    };
+
+    static func roundUp(size_t value, size_t alignment) -> size_t
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    func FrameBuffer::recycle(Slab* slab) -> void
+    {
+        auto* storage = static_cast<FramePool::Storage*>(slab->storage);
+        if (storage == nullptr) {
+            slab->~Slab();
+            ::operator delete(slab, std::align_val_t(ALIGNMENT));
+            return;
+        }
+        storage->push(slab);
+        storage->unreference();
+    }
+
+    FramePool::FramePool() : FramePool(Options()) {}
+
+    FramePool::FramePool(const Options & options) : storage(new Storage())
+    {
+        this->storage->slabSize = options.slabSize;
+        this->storage->stride = roundUp(sizeof(Slab) + options.slabSize, FrameBuffer::ALIGNMENT);
+        this->storage->count = options.slabs;
+        this->storage->memory = static_cast<byte_t*>(::operator new(
+            this->storage->stride * options.slabs, std::align_val_t(FrameBuffer::ALIGNMENT)
+        ));
+        for (size_t i = options.slabs; i-- > 0; ) {
+            Slab* slab = new (this->storage->slabAt(i)) Slab();
+            slab->index = (uint32_t) i;
+            slab->storage = this->storage;
+            this->storage->push(slab);
+        }
+    }
+
+    FramePool::~FramePool()
+    {
+        // buffers still held by subscribers keep the slabs alive
+        this->storage->unreference();
+    }
+
+    func FramePool::acquire(size_t length) -> FrameBuffer
+    {
+        Slab* slab = nullptr;
+        if (length > this->storage->slabSize) {
+            this->storage->oversized.fetch_add(1, std::memory_order_relaxed);
+        } else if ((slab = this->storage->pop()) == nullptr) {
+            this->storage->exhausted.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            this->storage->users.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (slab == nullptr) {
+            void* memory = ::operator new(sizeof(Slab) + length, std::align_val_t(FrameBuffer::ALIGNMENT));
+            slab = new (memory) Slab();
+        }
+
+        slab->references.store(1, std::memory_order_relaxed);
+        slab->length = (uint16_t) length;
+        this->storage->acquired.fetch_add(1, std::memory_order_relaxed);
+        return FrameBuffer(slab);
+    }
+
+    func FramePool::statistics() const -> Statistics
+    {
+        return Statistics {
+            this->storage->acquired.load(),
+            this->storage->oversized.load(),
+            this->storage->exhausted.load(),
+            this->storage->users.load() - 1,
+        };
+    }
+}
@@ -0,0 +1,32 @@
+#include "serial/FrameWaiters.hpp"
+
+#define func auto
+
+namespace serial
+{
+    func FrameWaiters::add(const Waiter & waiter) -> void
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->waiting.push_back(waiter);
+    }
+
+    func FrameWaiters::size() -> size_t
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->waiting.size();
+    }
+
+    func FrameWaiters::receive(void* target, const command::FrameView & frame) -> void
+    {
+        auto* waiters = static_cast<FrameWaiters*>(target);
+        {
+            // a waiter that waits again right away waits for the next frame
+            std::lock_guard<std::mutex> lock(waiters->mutex);
+            waiters->resuming.swap(waiters->waiting);
+        }
+        for (const Waiter & waiter : waiters->resuming) {
+            waiter.resume(waiter.context, frame);
+        }
+        waiters->resuming.clear();
+    }
+}
@@ -0,0 +1,213 @@
+#include "serial/LinkStatistics.hpp"
+
+#define func auto
+
+namespace serial
+{
+    static constexpr auto relaxed = std::memory_order_relaxed;
+
+    func LatencyHistogram::bucketOf(uint64_t value) -> size_t
+    {
+        if (value < SUB_BUCKETS) {
+            return (size_t) value;
+        }
+        auto magnitude = (unsigned) (63 - __builtin_clzll(value));
+        if (magnitude > MAX_MAGNITUDE) {
+            return BUCKETS - 1;
+        }
+        unsigned shift = magnitude - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    func LatencyHistogram::bucketLimit(size_t index) -> uint64_t
+    {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        size_t shift = index / SUB_BUCKETS - 1;
+        uint64_t lowest = (uint64_t) (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+        return lowest + (1ull << shift) - 1;
+    }
+
+    func LatencyHistogram::record(uint64_t nanoseconds) -> void
+    {
+        this->counts[bucketOf(nanoseconds)].fetch_add(1, relaxed);
+        this->sum.fetch_add(nanoseconds, relaxed);
+
+        uint64_t lowest = this->min.load(relaxed);
+        while (nanoseconds < lowest && !this->min.compare_exchange_weak(lowest, nanoseconds, relaxed)) {}
+        uint64_t highest = this->max.load(relaxed);
+        while (nanoseconds > highest && !this->max.compare_exchange_weak(highest, nanoseconds, relaxed)) {}
+    }
+
+    func LatencyHistogram::snapshot() const -> Snapshot
+    {
+        Snapshot snapshot { 0, 0, 0, 0, std::vector<uint64_t>(BUCKETS) };
+        for (size_t i = 0; i < BUCKETS; i++) {
+            snapshot.buckets[i] = this->counts[i].load(relaxed);
+            snapshot.count += snapshot.buckets[i];
+        }
+        snapshot.sum = this->sum.load(relaxed);
+        snapshot.max = this->max.load(relaxed);
+        snapshot.min = snapshot.count == 0 ? 0 : this->min.load(relaxed);
+        return snapshot;
+    }
+
+    func LatencyHistogram::reset() -> void
+    {
+        for (auto & bucket : this->counts) {
+            bucket.store(0, relaxed);
+        }
+        this->sum.store(0, relaxed);
+        this->min.store(UINT64_MAX, relaxed);
+        this->max.store(0, relaxed);
+    }
+
+    func LatencyHistogram::Snapshot::percentile(double percentile) const -> uint64_t
+    {
+        if (this->count == 0) {
+            return 0;
+        }
+        auto rank = (uint64_t) (percentile / 100.0 * (double) this->count + 0.5);
+        rank = rank < 1 ? 1 : rank > this->count ? this->count : rank;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < this->buckets.size(); i++) {
+            seen += this->buckets[i];
+            if (seen >= rank) {
+                uint64_t limit = bucketLimit(i);
+                return limit < this->min ? this->min : limit > this->max ? this->max : limit;
+            }
+        }
+        return this->max;
+    }
+
+    func LatencyHistogram::Snapshot::mean() const -> double
+    {
+        return this->count == 0 ? 0.0 : (double) this->sum / (double) this->count;
+    }
+
+    func LinkStatistics::Command::called(Clock::time_point decoded, Clock::time_point start, Clock::time_point end) -> void
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::nanoseconds;
+        this->latency.record((uint64_t) duration_cast<nanoseconds>(start - decoded).count());
+        this->callbackDuration.record((uint64_t) duration_cast<nanoseconds>(end - start).count());
+    }
+
+    template <typename T>
+    static func installed(std::atomic<T*> & slot) -> T*
+    {
+        T* current = slot.load(std::memory_order_acquire);
+        if (current != nullptr) {
+            return current;
+        }
+        // racing creators each allocate, the loser frees its copy
+        T* created = new T();
+        if (slot.compare_exchange_strong(current, created, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return created;
+        }
+        delete created;
+        return current;
+    }
+
+    LinkStatistics::~LinkStatistics()
+    {
+        for (auto & page : this->pages) {
+            Page* commands = page.load();
+            if (commands == nullptr) {
+                continue;
+            }
+            for (auto & command : commands->commands) {
+                delete command.load();
+            }
+            delete commands;
+        }
+    }
+
+    func LinkStatistics::command(uint16_t commandId) -> Command &
+    {
+        Page* page = installed(this->pages[commandId >> 8]);
+        return *installed(page->commands[commandId & 0xFF]);
+    }
+
+    func LinkStatistics::decoded(const command::FrameDecoder::Statistics & totals) -> void
+    {
+        command::FrameDecoder::Statistics & last = this->published;
+        this->frames.fetch_add(totals.frames - last.frames, relaxed);
+        this->crc8Failures.fetch_add(totals.crc8Failures - last.crc8Failures, relaxed);
+        this->crc16Failures.fetch_add(totals.crc16Failures - last.crc16Failures, relaxed);
+        this->oversizedFrames.fetch_add(totals.oversizedFrames - last.oversizedFrames, relaxed);
+        this->resyncs.fetch_add(totals.resyncs - last.resyncs, relaxed);
+        this->bytesDiscarded.fetch_add(totals.bytesDiscarded - last.bytesDiscarded, relaxed);
+        last = totals;
+    }
+
+    func LinkStatistics::snapshot() const -> Snapshot
+    {
+        Snapshot snapshot {
+            this->bytesReceived.load(relaxed),
+            this->frames.load(relaxed),
+            this->crc8Failures.load(relaxed),
+            this->crc16Failures.load(relaxed),
+            this->oversizedFrames.load(relaxed),
+            this->resyncs.load(relaxed),
+            this->bytesDiscarded.load(relaxed),
+            {}
+        };
+        for (size_t high = 0; high < this->pages.size(); high++) {
+            const Page* page = this->pages[high].load(std::memory_order_acquire);
+            if (page == nullptr) {
+                continue;
+            }
+            for (size_t low = 0; low < page->commands.size(); low++) {
+                const Command* command = page->commands[low].load(std::memory_order_acquire);
+                if (command == nullptr || (command->frames.load(relaxed) == 0 && command->incomplete.load(relaxed) == 0)) {
+                    continue;
+                }
+                snapshot.commands[(uint16_t) (high << 8 | low)] = CommandSnapshot {
+                    command->frames.load(relaxed),
+                    command->bytes.load(relaxed),
+                    command->shortFrames.load(relaxed),
+                    command->badLengthFrames.load(relaxed),
+                    command->unhandled.load(relaxed),
+                    command->incomplete.load(relaxed),
+                    command->latency.snapshot(),
+                    command->callbackDuration.snapshot(),
+                };
+            }
+        }
+        return snapshot;
+    }
+
+    func LinkStatistics::reset() -> void
+    {
+        this->bytesReceived.store(0, relaxed);
+        this->frames.store(0, relaxed);
+        this->crc8Failures.store(0, relaxed);
+        this->crc16Failures.store(0, relaxed);
+        this->oversizedFrames.store(0, relaxed);
+        this->resyncs.store(0, relaxed);
+        this->bytesDiscarded.store(0, relaxed);
+        for (auto & page : this->pages) {
+            Page* commands = page.load(std::memory_order_acquire);
+            if (commands == nullptr) {
+                continue;
+            }
+            for (auto & slot : commands->commands) {
+                Command* command = slot.load(std::memory_order_acquire);
+                if (command == nullptr) {
+                    continue;
+                }
+                command->frames.store(0, relaxed);
+                command->bytes.store(0, relaxed);
+                command->shortFrames.store(0, relaxed);
+                command->badLengthFrames.store(0, relaxed);
+                command->unhandled.store(0, relaxed);
+                command->incomplete.store(0, relaxed);
+                command->latency.reset();
+                command->callbackDuration.reset();
+            }
+        }
+    }
+}
@@ -0,0 +1,390 @@
+#include "serial/utils/Logger.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#include <unistd.h>
+
+#define func auto
+
+namespace logger
+{
+    using namespace io;
+
+    using Mutex = std::mutex;
+    using Lock = std::unique_lock<Mutex>;
+
+    static const char* const RESET = "\033[0m";
+
+    static func label(LogLevel level) -> const char*
+    {
+        switch (level) {
+            case level::LOG_ERROR:   return "\033[0;31m ERROR ";
+            case level::LOG_WARNING: return "\033[0;33m WARN  ";
+            case level::LOG_INFO:    return "\033[0;32m INFO  ";
+            default:                 return "\033[0;36m DEBUG ";
+        }
+    }
+
+    /**
+     * "YYYY-mm-dd HH:MM:SS.mmm", localtime is only asked once per second
+     */
+    static func appendTime(string & line, int64_t time) -> void
+    {
+        thread_local time_t cachedSecond = -1;
+        thread_local char cached[32];
+        thread_local size_t cachedLength = 0;
+
+        auto second = (time_t) (time / 1000000000);
+        if (second != cachedSecond) {
+            struct tm local {};
+            ::localtime_r(&second, &local);
+            cachedLength = std::strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &local);
+            cachedSecond = second;
+        }
+        char millisecond[8];
+        std::snprintf(millisecond, sizeof(millisecond), ".%03d", (int) (time / 1000000 % 1000));
+        line.append(cached, cachedLength);
+        line.append(millisecond);
+    }
+
+    static func appendThread(string & line, std::thread::id thread) -> void
+    {
+        thread_local std::thread::id cachedThread;
+        thread_local string cached;
+        if (thread != cachedThread || cached.empty()) {
+            std::ostringstream stream;
+            stream << thread;
+            cached = stream.str();
+            cachedThread = thread;
+        }
+        line += cached;
+    }
+
+    template <typename T>
+    static func appendNumber(string & line, T value) -> void
+    {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        line.append(digits, result.ptr);
+    }
+
+    func io::format(const Record & record, string & line) -> void
+    {
+        line += "\033[0;34m[";
+        line += RESET;
+        line += label(record.level);
+        line += RESET;
+        line += "T";
+        appendThread(line, record.thread);
+        line += " ";
+        appendTime(line, record.time);
+        line += " \033[0;34m]";
+        line += RESET;
+        line += " ";
+
+        const unsigned char* argument = record.arguments;
+        const unsigned char* end = record.arguments + record.length;
+        while (argument < end) {
+            auto tag = (Tag) *argument++;
+            switch (tag) {
+
+                case Tag::STRING:
+                {
+                    uint16_t size;
+                    std::memcpy(&size, argument, sizeof(size));
+                    line.append((const char*) argument + sizeof(size), size);
+                    argument += sizeof(size) + size;
+                }
+                break;
+
+                case Tag::SIGNED:
+                {
+                    int64_t value;
+                    std::memcpy(&value, argument, sizeof(value));
+                    appendNumber(line, value);
+                    argument += sizeof(value);
+                }
+                break;
+
+                case Tag::UNSIGNED:
+                {
+                    uint64_t value;
+                    std::memcpy(&value, argument, sizeof(value));
+                    appendNumber(line, value);
+                    argument += sizeof(value);
+                }
+                break;
+
+                case Tag::FLOATING:
+                {
+                    double value;
+                    std::memcpy(&value, argument, sizeof(value));
+                    char digits[32];
+                    std::snprintf(digits, sizeof(digits), "%g", value);  // what an ostream prints
+                    line += digits;
+                    argument += sizeof(value);
+                }
+                break;
+
+                case Tag::CHARACTER:
+                {
+                    line += (char) *argument;
+                    argument += 1;
+                }
+                break;
+
+                case Tag::BOOLEAN:
+                {
+                    line += *argument ? '1' : '0';
+                    argument += 1;
+                }
+                break;
+            }
+        }
+        if (record.truncated) {
+            line += "...";
+        }
+        line += '\n';
+    }
+
+    /**
+     * Bounded multi-producer queue of records in the style of Vyukov's
+     * MPMC queue: a producer claims a slot with one CAS on the enqueue
+     * position and publishes it through the slot sequence. The single
+     * consumer formats whole batches and writes each with one syscall.
+     */
+    class AsyncBackend
+    {
+      private:
+
+        struct Slot
+        {
+            std::atomic<size_t> sequence;
+            Record record;
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        size_t capacity;
+        size_t mask;
+
+        alignas(64) std::atomic<size_t> enqueuePosition { 0 };
+        alignas(64) size_t dequeuePosition = 0;
+
+        alignas(64) std::atomic<size_t> written { 0 };
+        std::atomic<uint64_t> dropped { 0 };
+        std::atomic_bool consumerParked { false };
+        std::atomic_bool running { false };
+
+        Mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable drained;
+        std::thread thread;
+
+        func ready() const -> bool
+        {
+            const Slot & slot = this->slots[this->dequeuePosition & this->mask];
+            return slot.sequence.load(std::memory_order_acquire) == this->dequeuePosition + 1;
+        }
+
+        static func writeAll(const string & text) -> void
+        {
+            size_t done = 0;
+            while (done < text.size()) {
+                ssize_t result = ::write(STDERR_FILENO, text.data() + done, text.size() - done);
+                if (result <= 0) {
+                    if (result < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    return;
+                }
+                done += (size_t) result;
+            }
+        }
+
+        func consume() -> void
+        {
+            string batch;
+            batch.reserve(64 * 1024);
+            while (true) {
+                size_t count = 0;
+                while (count < 256 && this->ready()) {
+                    Slot & slot = this->slots[this->dequeuePosition & this->mask];
+                    format(slot.record, batch);
+                    slot.sequence.store(this->dequeuePosition + this->capacity, std::memory_order_release);
+                    this->dequeuePosition++;
+                    count++;
+                }
+
+                uint64_t lost = this->dropped.exchange(0, std::memory_order_relaxed);
+                if (lost > 0) {
+                    Record record {};
+                    record.level = level::LOG_WARNING;
+                    record.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()
+                    ).count();
+                    record.thread = std::this_thread::get_id();
+                    encode(record, lost);
+                    encode(record, " log messages dropped, the queue was full");
+                    format(record, batch);
+                }
+
+                if (!batch.empty()) {
+                    writeAll(batch);
+                    batch.clear();
+                }
+                if (count > 0 || lost > 0) {
+                    Lock lock(this->mutex);
+                    this->written.store(this->dequeuePosition, std::memory_order_release);
+                    this->drained.notify_all();
+                    continue;
+                }
+
+                if (!this->running.load(std::memory_order_acquire)) {
+                    return;
+                }
+                this->consumerParked.store(true);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                {
+                    Lock lock(this->mutex);
+                    this->wake.wait_for(lock, std::chrono::milliseconds(50), [this] {
+                        return this->ready() || !this->running.load(std::memory_order_acquire);
+                    });
+                }
+                this->consumerParked.store(false);
+            }
+        }
+
+      public:
+
+        explicit AsyncBackend(size_t capacity)
+        {
+            size_t power = 64;
+            while (power < capacity) {
+                power <<= 1;
+            }
+            this->capacity = power;
+            this->mask = power - 1;
+            this->slots = std::make_unique<Slot[]>(power);
+            for (size_t i = 0; i < power; i++) {
+                this->slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        func push(const Record & record) -> void
+        {
+            size_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true) {
+                slot = &this->slots[position & this->mask];
+                size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                auto difference = (intptr_t) sequence - (intptr_t) position;
+                if (difference == 0) {
+                    if (this->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    this->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                } else {
+                    position = this->enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            std::memcpy(&slot->record, &record, offsetof(Record, arguments) + record.length);
+            slot->sequence.store(position + 1, std::memory_order_release);
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (this->consumerParked.load(std::memory_order_relaxed)) {
+                Lock lock(this->mutex);
+                this->wake.notify_one();
+            }
+        }
+
+        func start() -> void
+        {
+            this->running.store(true, std::memory_order_release);
+            this->thread = std::thread(&AsyncBackend::consume, this);
+        }
+
+        func stop() -> void
+        {
+            {
+                Lock lock(this->mutex);
+                this->running.store(false, std::memory_order_release);
+                this->wake.notify_one();
+            }
+            if (this->thread.joinable()) {
+                this->thread.join();
+            }
+        }
+
+        func flush() -> void
+        {
+            size_t target = this->enqueuePosition.load(std::memory_order_acquire);
+            Lock lock(this->mutex);
+            this->drained.wait(lock, [&] {
+                return this->written.load(std::memory_order_acquire) >= target || !this->running.load();
+            });
+        }
+    };
+
+    static Mutex controlMutex;
+    static AsyncBackend* backend = nullptr;   // kept for the whole process, threads may log during exit
+    static std::atomic<AsyncBackend*> active { nullptr };
+
+    func io::submit(const Record & record) -> void
+    {
+        AsyncBackend* queue = active.load(std::memory_order_acquire);
+        if (queue != nullptr) {
+            queue->push(record);
+            return;
+        }
+        thread_local string line;
+        line.clear();
+        format(record, line);
+        std::cerr << line;
+    }
+
+    func startAsync(size_t capacity) -> void
+    {
+        std::lock_guard<Mutex> lock(controlMutex);
+        if (active.load() != nullptr) {
+            return;
+        }
+        if (backend == nullptr) {
+            backend = new AsyncBackend(capacity);
+            std::atexit(stopAsync);
+        }
+        backend->start();
+        active.store(backend, std::memory_order_release);
+    }
+
+    func stopAsync() -> void
+    {
+        std::lock_guard<Mutex> lock(controlMutex);
+        if (active.load() == nullptr) {
+            return;
+        }
+        // a call that saw the backend just before this stays queued until the next start
+        active.store(nullptr, std::memory_order_release);
+        backend->stop();
+    }
+
+    func flush() -> void
+    {
+        AsyncBackend* queue = active.load(std::memory_order_acquire);
+        if (queue != nullptr) {
+            queue->flush();
+        }
+        std::cerr.flush();
+    }
+}
@@ -0,0 +1,267 @@
+#include "serial/PrioritySender.hpp"
+#include "serial/utils/Logger.hpp"
+
+#include <algorithm>
+
+#define func auto
+
+namespace serial
+{
+    func PrioritySender::Transfer::append(const struct iovec* buffers, int count) -> void
+    {
+        for (int i = 0; i < count; i++) {
+            const auto* bytes = static_cast<const byte_t*>(buffers[i].iov_base);
+            this->bytes.insert(this->bytes.end(), bytes, bytes + buffers[i].iov_len);
+        }
+        this->ends.push_back(this->bytes.size());
+    }
+
+    func PrioritySender::Transfer::clear() -> void
+    {
+        this->bytes.clear();
+        this->ends.clear();
+        this->next = 0;
+    }
+
+    func PrioritySender::Transfer::remaining() const -> size_t
+    {
+        return this->bytes.size() - (this->next == 0 ? 0 : this->ends[this->next - 1]);
+    }
+
+    PrioritySender::PrioritySender(Sink sink, const Options & options) : sink(std::move(sink)), options(options)
+    {
+        if (this->options.capacity < 1) {
+            this->options.capacity = 1;
+        }
+        if (this->options.maxGather < 1) {
+            this->options.maxGather = 1;
+        }
+        if (this->options.bytesPerSecond < 1) {
+            this->options.bytesPerSecond = 1;
+        }
+        auto bytes = (size_t) ((double) this->options.timeSlice.count() * (double) this->options.bytesPerSecond / 1e6);
+        this->sliceBytes = std::max(bytes, MIN_SLICE_BYTES);
+        this->writerThread = std::thread(&PrioritySender::writerDaemon, this);
+    }
+
+    PrioritySender::~PrioritySender()
+    {
+        {
+            Lock lock(this->mutex);
+            this->running = false;
+        }
+        this->wakeup.notify_all();
+        this->progress.notify_all();
+        if (this->writerThread.joinable()) {
+            this->writerThread.join();
+        }
+    }
+
+    func PrioritySender::takeSpare() -> Transfer
+    {
+        if (this->spare.empty()) {
+            return Transfer {};
+        }
+        Transfer transfer = std::move(this->spare.back());
+        this->spare.pop_back();
+        return transfer;
+    }
+
+    func PrioritySender::recycle(Transfer && transfer) -> void
+    {
+        transfer.clear();
+        if (this->spare.size() < this->options.capacity) {
+            this->spare.push_back(std::move(transfer));
+        }
+    }
+
+    func PrioritySender::transfer() -> Transfer
+    {
+        Lock lock(this->mutex);
+        return this->takeSpare();
+    }
+
+    func PrioritySender::push(Priority priority, const struct iovec* buffers, int count) -> bool
+    {
+        Transfer transfer = this->transfer();
+        transfer.append(buffers, count);
+        return this->push(priority, std::move(transfer));
+    }
+
+    func PrioritySender::push(Priority priority, Transfer && transfer) -> bool
+    {
+        if (transfer.empty()) {
+            return true;
+        }
+        Lock lock(this->mutex);
+        return this->enqueue(lock, priority, std::move(transfer));
+    }
+
+    func PrioritySender::enqueue(Lock & lock, Priority priority, Transfer && transfer) -> bool
+    {
+        Lane & lane = this->lanes[(size_t) priority];
+        lane.pushed++;
+
+        while (lane.queue.size() >= this->options.capacity) {
+            if (this->options.overflow == OverflowPolicy::DROP_OLDEST) {
+                lane.bytes -= lane.queue.front().remaining();
+                this->recycle(std::move(lane.queue.front()));
+                lane.queue.pop_front();
+                lane.dropped++;
+                lane.done++;
+                this->progress.notify_all();
+            } else if (this->options.overflow == OverflowPolicy::BLOCK && this->running) {
+                this->progress.wait(lock);
+            } else {
+                this->recycle(std::move(transfer));
+                lane.dropped++;
+                lane.done++;
+                this->progress.notify_all();
+                return false;
+            }
+        }
+
+        lane.bytes += transfer.remaining();
+        lane.queue.push_back(std::move(transfer));
+        lane.maxDepth = std::max(lane.maxDepth, lane.queue.size());
+        this->wakeup.notify_one();
+        return true;
+    }
+
+    func PrioritySender::flush() -> void
+    {
+        Lock lock(this->mutex);
+        std::array<uint64_t, LANES> tickets {};
+        for (size_t i = 0; i < LANES; i++) {
+            tickets[i] = this->lanes[i].pushed;
+        }
+        this->progress.wait(lock, [&] {
+            for (size_t i = 0; i < LANES; i++) {
+                if (this->lanes[i].done < tickets[i]) {
+                    return !this->running;
+                }
+            }
+            return true;
+        });
+    }
+
+    func PrioritySender::backlog(Priority priority) const -> Duration
+    {
+        Lock lock(this->mutex);
+        size_t bytes = 0;
+        for (size_t i = 0; i <= (size_t) priority; i++) {
+            bytes += this->lanes[i].bytes;
+        }
+        auto now = Clock::now();
+        auto onWire = this->lineFreeAt > now ? std::chrono::duration_cast<Duration>(this->lineFreeAt - now) : Duration(0);
+        return onWire + Duration((int64_t) ((double) bytes * 1e6 / (double) this->options.bytesPerSecond));
+    }
+
+    func PrioritySender::statistics() const -> Statistics
+    {
+        Lock lock(this->mutex);
+        Statistics statistics {};
+        for (size_t i = 0; i < LANES; i++) {
+            const Lane & lane = this->lanes[i];
+            statistics.lanes[i] = LaneStatistics {
+                lane.pushed,
+                lane.written,
+                lane.dropped,
+                lane.queue.size(),
+                lane.maxDepth,
+            };
+        }
+        statistics.preemptions = this->preemptions;
+        statistics.writeFailures = this->writeFailures;
+        return statistics;
+    }
+
+    func PrioritySender::writerDaemon() -> void
+    {
+        const auto maxGather = (size_t) this->options.maxGather;
+        std::vector<struct iovec> buffers(maxGather);
+        std::vector<Transfer> writing;    // out of their lane while the lock is released
+        writing.reserve(maxGather);
+
+        Lock lock(this->mutex);
+        while (true) {
+
+            size_t index = 0;
+            while (index < LANES && this->lanes[index].queue.empty()) {
+                index++;
+            }
+            if (index == LANES) {
+                if (!this->running) {
+                    return;
+                }
+                this->wakeup.wait(lock);
+                continue;
+            }
+
+            auto start = Clock::now();
+            if (index == (size_t) Priority::HIGH) {
+                for (size_t lower = index + 1; lower < LANES; lower++) {
+                    if (!this->lanes[lower].queue.empty()) {
+                        this->preemptions++;
+                        break;
+                    }
+                }
+            } else if (start < this->lineFreeAt && this->running) {
+                // the previous slice is still on the wire, a push to a higher lane wakes us
+                this->wakeup.wait_until(lock, this->lineFreeAt);
+                continue;
+            }
+
+            Lane & lane = this->lanes[index];
+            size_t budget = index == (size_t) Priority::HIGH ? SIZE_MAX : this->sliceBytes;
+            size_t count = 0;
+            size_t total = 0;
+            bool partial = false;
+            while (count < maxGather && !partial && !lane.queue.empty()) {
+                Transfer & transfer = lane.queue.front();
+                while (transfer.next < transfer.ends.size() && count < maxGather) {
+                    size_t begin = transfer.next == 0 ? 0 : transfer.ends[transfer.next - 1];
+                    size_t length = transfer.ends[transfer.next] - begin;
+                    if (count > 0 && total + length > budget) {
+                        break;
+                    }
+                    buffers[count++] = { transfer.bytes.data() + begin, length };
+                    total += length;
+                    transfer.next++;
+                }
+                partial = transfer.next < transfer.ends.size();
+                writing.push_back(std::move(transfer));
+                lane.queue.pop_front();
+            }
+
+            lock.unlock();
+            int result = -1;
+            try {
+                result = this->sink(buffers.data(), (int) count);
+            } catch (std::exception & exception) {
+                static logger::RateLimiter limiter;
+                logger::error(limiter, "Prioritized send failed: ", exception.what());
+            }
+            lock.lock();
+
+            if (result != (int) total) {
+                this->writeFailures++;
+            }
+            auto lineTime = std::chrono::nanoseconds((int64_t) ((double) total * 1e9 / (double) this->options.bytesPerSecond));
+            this->lineFreeAt = std::max(start, this->lineFreeAt) + std::chrono::duration_cast<Clock::duration>(lineTime);
+            lane.written += count;
+            lane.bytes -= total;
+
+            if (partial) {
+                lane.queue.push_front(std::move(writing.back()));
+                writing.pop_back();
+            }
+            for (Transfer & transfer : writing) {
+                this->recycle(std::move(transfer));
+                lane.done++;
+            }
+            writing.clear();
+            this->progress.notify_all();
+        }
+    }
+}
@@ -0,0 +1,282 @@
+#include "serial/Reactor.hpp"
+#include "serial/utils/Logger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define func auto
+
+namespace serial
+{
+    Reactor::Reactor(size_t threads, size_t bufferSize)
+    {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (size_t i = 0; i < threads; i++) {
+            auto shard = std::make_unique<Shard>();
+            shard->epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+            shard->wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            shard->buffer.resize(bufferSize);
+            struct epoll_event event {};
+            event.events = EPOLLIN;
+            event.data.ptr = nullptr;
+            ::epoll_ctl(shard->epollFd, EPOLL_CTL_ADD, shard->wakeFd, &event);
+            this->shards.emplace_back(std::move(shard));
+        }
+    }
+
+    Reactor::~Reactor()
+    {
+        this->stop();
+        for (auto & shard : this->shards) {
+            {
+                Lock lock(shard->mutex);
+                while (!shard->handles.empty()) {
+                    this->detach(*shard, shard->handles.begin()->first);
+                }
+            }
+            ::close(shard->wakeFd);
+            ::close(shard->epollFd);
+        }
+    }
+
+    func Reactor::add(CommHandle & handle) -> bool
+    {
+        if (handle.isReceiving()) {
+            logger::warning("Handle is already receiving, not adding it to the reactor");
+            return false;
+        }
+
+        Shard* target = this->shards.front().get();
+        size_t least = SIZE_MAX;
+        for (auto & shard : this->shards) {
+            Lock lock(shard->mutex);
+            if (shard->handles.size() < least) {
+                least = shard->handles.size();
+                target = shard.get();
+            }
+        }
+
+        Lock lock(target->mutex);
+        int fd = handle.serialPort.getFileDescriptor();
+        struct epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.ptr = &handle;
+        if (::epoll_ctl(target->epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            logger::error("Unable to watch serial device, errno ", errno);
+            return false;
+        }
+        target->handles[&handle] = { fd, handle.connections, false, Clock::time_point() };
+        handle.reactor = this;
+        handle.receivingStateFlag = true;
+        return true;
+    }
+
+    func Reactor::remove(CommHandle & handle) -> void
+    {
+        for (auto & shard : this->shards) {
+            Lock lock(shard->mutex);
+            if (shard->handles.count(&handle) > 0) {
+                this->detach(*shard, &handle);
+                return;
+            }
+        }
+    }
+
+    func Reactor::detach(Shard & shard, CommHandle* handle) -> void
+    {
+        Registration & registration = shard.handles[handle];
+        if (registration.reconnecting) {
+            // already unwatched, the number may belong to another port by now
+            shard.reconnecting--;
+        } else {
+            ::epoll_ctl(shard.epollFd, EPOLL_CTL_DEL, registration.fd, nullptr);
+        }
+        shard.handles.erase(handle);
+        handle->reactor = nullptr;
+        handle->receivingStateFlag = false;
+    }
+
+    func Reactor::start() -> bool
+    {
+        if (this->running.exchange(true)) {
+            return false;
+        }
+        for (auto & shard : this->shards) {
+            Shard* target = shard.get();
+            shard->thread = std::thread([this, target] { this->loop(*target); });
+        }
+        return true;
+    }
+
+    func Reactor::run() -> void
+    {
+        if (this->running.exchange(true)) {
+            return;
+        }
+        for (size_t i = 1; i < this->shards.size(); i++) {
+            Shard* target = this->shards[i].get();
+            target->thread = std::thread([this, target] { this->loop(*target); });
+        }
+        this->loop(*this->shards.front());
+    }
+
+    func Reactor::stop() -> void
+    {
+        this->running = false;
+        for (auto & shard : this->shards) {
+            uint64_t one = 1;
+            (void) ::write(shard->wakeFd, &one, sizeof(one));
+        }
+        for (auto & shard : this->shards) {
+            if (shard->thread.joinable() && shard->thread.get_id() != std::this_thread::get_id()) {
+                shard->thread.join();
+            }
+        }
+    }
+
+    func Reactor::size() -> size_t
+    {
+        size_t count = 0;
+        for (auto & shard : this->shards) {
+            Lock lock(shard->mutex);
+            count += shard->handles.size();
+        }
+        return count;
+    }
+
+    func Reactor::loop(Shard & shard) -> void
+    {
+        const int MAX_EVENTS = 64;
+        struct epoll_event events[MAX_EVENTS];
+
+        int timeout = -1;
+        while (this->running) {
+            int ready = ::epoll_wait(shard.epollFd, events, MAX_EVENTS, timeout);
+            if (ready == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                logger::error("epoll_wait failed, errno ", errno);
+                return;
+            }
+            for (int i = 0; i < ready; i++) {
+                auto* handle = static_cast<CommHandle*>(events[i].data.ptr);
+                if (handle == nullptr) {
+                    uint64_t value;
+                    (void) ::read(shard.wakeFd, &value, sizeof(value));
+                    continue;
+                }
+                Lock lock(shard.mutex);
+                // the handle may have been removed by an earlier callback in this batch
+                if (shard.handles.count(handle) > 0) {
+                    this->service(shard, handle, events[i].events);
+                }
+            }
+            timeout = this->retryReconnects(shard);
+        }
+    }
+
+    func Reactor::service(Shard & shard, CommHandle* handle, uint32_t events) -> void
+    {
+        if (shard.handles[handle].reconnecting) {
+            return;  // suspended by an earlier event of this batch
+        }
+
+        int received;
+        try {
+            received = handle->receiveAvailable(shard.buffer.data(), shard.buffer.size());
+        } catch (SerialClosedException & exception) {
+            if (handle->doReconnect) {
+                this->suspend(shard, handle);
+            } else {
+                this->detach(shard, handle);
+            }
+            return;
+        }
+
+        if (shard.handles.count(handle) == 0) {
+            return;  // removed from within a callback
+        }
+
+        Registration & registration = shard.handles[handle];
+        bool reconnected = registration.connection != handle->connections;
+
+        if (received <= 0 && (events & (EPOLLHUP | EPOLLERR)) && !reconnected) {
+            // hung up without the read noticing, the fd would stay readable forever
+            logger::error("Serial device connection closed");
+            if (handle->doReconnect) {
+                this->suspend(shard, handle);
+            } else {
+                this->detach(shard, handle);
+            }
+            return;
+        }
+
+        if (reconnected) {
+            // reopened by a publishing thread, watch the new descriptor even if the number was reused
+            ::epoll_ctl(shard.epollFd, EPOLL_CTL_DEL, registration.fd, nullptr);
+            this->watch(shard, handle);
+        }
+    }
+
+    func Reactor::suspend(Shard & shard, CommHandle* handle) -> void
+    {
+        Registration & registration = shard.handles[handle];
+        ::epoll_ctl(shard.epollFd, EPOLL_CTL_DEL, registration.fd, nullptr);
+        handle->serialPort.close();
+        registration.reconnecting = true;
+        registration.retryAt = Clock::now();
+        shard.reconnecting++;
+        logger::info("Reconnecting...");
+    }
+
+    func Reactor::watch(Shard & shard, CommHandle* handle) -> void
+    {
+        Registration & registration = shard.handles[handle];
+        registration.fd = handle->serialPort.getFileDescriptor();
+        registration.connection = handle->connections;
+        struct epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.ptr = handle;
+        if (::epoll_ctl(shard.epollFd, EPOLL_CTL_ADD, registration.fd, &event) == -1) {
+            logger::error("Unable to watch serial device, errno ", errno);
+        }
+    }
+
+    func Reactor::retryReconnects(Shard & shard) -> int
+    {
+        Lock lock(shard.mutex);
+        if (shard.reconnecting == 0) {
+            return -1;
+        }
+
+        Clock::time_point now = Clock::now();
+        Clock::time_point next = Clock::time_point::max();
+        for (auto & [handle, registration] : shard.handles) {
+            if (!registration.reconnecting) {
+                continue;
+            }
+            if (registration.retryAt <= now) {
+                if (handle->tryReconnect()) {
+                    registration.reconnecting = false;
+                    shard.reconnecting--;
+                    this->watch(shard, handle);
+                    continue;
+                }
+                registration.retryAt = now + RETRY_INTERVAL;
+            }
+            next = std::min(next, registration.retryAt);
+        }
+        if (next == Clock::time_point::max()) {
+            return -1;
+        }
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+        return (int) std::max<long long>(wait, 0) + 1;
+    }
+}
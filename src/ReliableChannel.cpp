@@ -0,0 +1,576 @@
+#include "serial/ReliableChannel.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#define func auto
+
+namespace serial
+{
+    using namespace std::literals::chrono_literals;
+
+    using command::FrameBuffer;
+    using command::FrameView;
+
+    static func lowestBit(uint32_t mask) -> unsigned
+    {
+        unsigned bit = 0;
+        while ((mask & 1u) == 0) {
+            mask >>= 1;
+            bit++;
+        }
+        return bit;
+    }
+
+    // a numbered frame starved in the bulk lane would hold back every frame numbered after it
+    static func wireLane(Priority priority) -> Priority
+    {
+        return priority == Priority::BULK ? Priority::NORMAL : priority;
+    }
+
+    ReliableChannel::ReliableChannel(Encoder encoder, Writer writer, AckWriter ackWriter, Deliverer deliverer,
+                                     Backlog backlog, command::FramePool* pool, const Options & options)
+        : encoder(std::move(encoder)), writer(std::move(writer)), ackWriter(std::move(ackWriter)),
+          deliverer(std::move(deliverer)), backlog(std::move(backlog)), pool(pool), options(options)
+    {
+        this->options.window = std::min(std::max(this->options.window, (size_t) 1), MAX_WINDOW);
+        this->options.backlog = std::max(this->options.backlog, (size_t) 1);
+        this->options.ackEvery = std::max(this->options.ackEvery, (size_t) 1);
+        this->timeout = std::min(std::max(this->options.initialTimeout, this->options.minTimeout), this->options.maxTimeout);
+        this->ready.reserve(MAX_WINDOW);
+        this->timerThread = std::thread(&ReliableChannel::timerDaemon, this);
+    }
+
+    ReliableChannel::~ReliableChannel()
+    {
+        {
+            Lock lock(this->senderMutex);
+            Lock timer(this->timerMutex);
+            this->running = false;
+        }
+        this->room.notify_all();
+        this->timerWakeup.notify_all();
+        if (this->timerThread.joinable()) {
+            this->timerThread.join();
+        }
+    }
+
+    func ReliableChannel::wakeTimer() -> void
+    {
+        {
+            Lock timer(this->timerMutex);
+            this->wakeups++;
+        }
+        this->timerWakeup.notify_one();
+    }
+
+    func ReliableChannel::windowFull() const -> bool
+    {
+        return (size_t) (uint8_t) (this->nextSequence - this->base) >= this->options.window;
+    }
+
+    func ReliableChannel::number(uint16_t commandId, const byte_t* data, size_t length, Priority priority) -> Slot &
+    {
+        Slot & slot = this->slots[this->nextSequence % MAX_WINDOW];
+        slot.sequence = this->nextSequence++;
+        slot.state = SlotState::PENDING;
+        slot.priority = priority;
+        slot.retries = 0;
+        slot.timeouts = 0;
+        slot.nacked = false;
+        this->encoder(commandId, data, length, slot.sequence, slot.bytes);
+        slot.sentAt = Clock::now() + this->backlog(wireLane(priority));
+        this->sent++;
+        return slot;
+    }
+
+    func ReliableChannel::send(uint16_t commandId, const void* data, size_t length, Priority priority, bool mayWait) -> bool
+    {
+        const auto* bytes = static_cast<const byte_t*>(data);
+        // the timer thread makes the room, a coroutine it resumed must not wait for it,
+        // and a high priority frame never waits behind a full backlog of lower ones
+        mayWait = mayWait && std::this_thread::get_id() != this->timerThread.get_id() && priority != Priority::HIGH;
+        Lock order(this->orderMutex);
+        Lock lock(this->senderMutex);
+        while (mayWait && this->running && this->waiting.size() >= this->options.backlog) {
+            // the timer thread needs `orderMutex` to make room
+            order.unlock();
+            this->room.wait(lock);
+            lock.unlock();
+            order.lock();
+            lock.lock();
+        }
+        if (!this->running) {
+            return false;
+        }
+        if (!this->waiting.empty() || this->windowFull()) {
+            // numbered by lane as the window opens, in order within a lane
+            auto at = std::find_if(this->waiting.begin(), this->waiting.end(), [priority](const Waiting & waiting) {
+                return waiting.priority > priority;
+            });
+            this->waiting.insert(at, Waiting { commandId, std::vector<byte_t>(bytes, bytes + length), priority });
+            return true;
+        }
+
+        Slot & slot = this->number(commandId, bytes, length, priority);
+        bool first = slot.sequence == this->base;
+        lock.unlock();
+        if (first) {
+            // nothing else was waiting, the timer may be sleeping long
+            this->wakeTimer();
+        }
+        // `orderMutex` is held, nobody reuses the slot while it is written
+        return this->writer(slot.bytes.data(), slot.bytes.size(), wireLane(priority));
+    }
+
+    func ReliableChannel::whenRoom(const RoomWaiter & waiter) -> bool
+    {
+        Lock lock(this->senderMutex);
+        if (!this->running || (this->roomWaiters.empty() && this->waiting.empty() && !this->windowFull())) {
+            return true;
+        }
+        this->roomWaiters.push_back(waiter);
+        return false;
+    }
+
+    func ReliableChannel::takeRoomWaiters(std::vector<RoomWaiter> & resuming) -> void
+    {
+        if (this->roomWaiters.empty() || !this->waiting.empty()) {
+            return;
+        }
+        auto inFlight = (uint8_t) (this->nextSequence - this->base);
+        size_t room = this->options.window > inFlight ? this->options.window - inFlight : 0;
+        while (room-- > 0 && !this->roomWaiters.empty()) {
+            resuming.push_back(this->roomWaiters.front());
+            this->roomWaiters.pop_front();
+        }
+    }
+
+    func ReliableChannel::drainWaiting() -> void
+    {
+        std::vector<RoomWaiter> resuming;
+        Lock order(this->orderMutex);
+        while (true) {
+            Slot* slot;
+            {
+                Lock lock(this->senderMutex);
+                if (!this->running || this->waiting.empty() || this->windowFull()) {
+                    if (this->running) {
+                        this->takeRoomWaiters(resuming);
+                    }
+                    break;
+                }
+                Waiting & next = this->waiting.front();
+                slot = &this->number(next.commandId, next.payload.data(), next.payload.size(), next.priority);
+                this->waiting.pop_front();
+            }
+            this->room.notify_all();
+            this->writer(slot->bytes.data(), slot->bytes.size(), wireLane(slot->priority));
+        }
+        order.unlock();
+        for (const RoomWaiter & waiter : resuming) {
+            waiter.resume(waiter.context);
+        }
+    }
+
+    func ReliableChannel::advanceBase() -> void
+    {
+        while (this->base != this->nextSequence && this->slots[this->base % MAX_WINDOW].state == SlotState::FREE) {
+            this->base++;
+        }
+        if (!this->waiting.empty() && !this->windowFull()) {
+            // written by the timer thread, the receiving thread never waits on a full send queue
+            this->wakeTimer();
+        }
+    }
+
+    func ReliableChannel::sample(Duration roundTrip) -> void
+    {
+        if (!this->measured) {
+            this->smoothedRoundTrip = roundTrip;
+            this->roundTripVariance = roundTrip / 2;
+            this->measured = true;
+        } else {
+            Duration error = this->smoothedRoundTrip > roundTrip
+                ? this->smoothedRoundTrip - roundTrip
+                : roundTrip - this->smoothedRoundTrip;
+            this->roundTripVariance = (this->roundTripVariance * 3 + error) / 4;
+            this->smoothedRoundTrip = (this->smoothedRoundTrip * 7 + roundTrip) / 8;
+        }
+        Duration timeout = this->smoothedRoundTrip + this->roundTripVariance * 4;
+        this->timeout = std::min(std::max(timeout, this->options.minTimeout), this->options.maxTimeout);
+    }
+
+    func ReliableChannel::collectRetransmissions(Clock::time_point now, const std::array<Duration, PrioritySender::LANES> & backlogs,
+                                                 std::vector<Retransmission> & retransmissions) -> Clock::time_point
+    {
+        auto backedOff = [this](const Slot & slot) {
+            return std::min(this->timeout * (1 << std::min(slot.timeouts, 16)), this->options.maxTimeout);
+        };
+        Clock::time_point wake = now + 100ms;
+        bool gaveUp = false;
+        for (uint8_t sequence = this->base; sequence != this->nextSequence; sequence++) {
+            Slot & slot = this->slots[sequence % MAX_WINDOW];
+            if (slot.state != SlotState::PENDING) {
+                continue;
+            }
+            bool timedOut = slot.sentAt + backedOff(slot) <= now;
+            if (timedOut && slot.timeouts >= this->options.maxRetries) {
+                slot.state = SlotState::FREE;
+                this->expired++;
+                gaveUp = true;
+                continue;
+            }
+            if (timedOut || slot.nacked) {
+                if (timedOut && !slot.nacked) {
+                    slot.timeouts++;
+                }
+                slot.nacked = false;
+                slot.sentAt = now + backlogs[(size_t) wireLane(slot.priority)];
+                slot.retries++;
+                this->retransmitted++;
+                retransmissions.push_back(Retransmission { slot.bytes, slot.priority });
+            }
+            wake = std::min(wake, slot.sentAt + backedOff(slot));
+        }
+        if (gaveUp) {
+            this->advanceBase();
+        }
+        return wake;
+    }
+
+    func ReliableChannel::acknowledge(const FrameView & frame) -> void
+    {
+        if (frame.dataLength < ACK_SIZE) {
+            return;
+        }
+        uint8_t next = frame.data[0];
+        uint32_t bitmap = (uint32_t) frame.data[1] | (uint32_t) frame.data[2] << 8
+                        | (uint32_t) frame.data[3] << 16 | (uint32_t) frame.data[4] << 24;
+
+        bool nacked = false;
+        std::vector<RoomWaiter> resuming;
+        {
+            Lock lock(this->senderMutex);
+            this->acksReceived++;
+            auto inFlight = (uint8_t) (this->nextSequence - this->base);
+            if ((uint8_t) (next - this->base) > inFlight) {
+                return;  // older than what is in flight, or from before a restart
+            }
+
+            Clock::time_point now = Clock::now();
+            auto acknowledge = [&](uint8_t sequence) {
+                Slot & slot = this->slots[sequence % MAX_WINDOW];
+                if (slot.state != SlotState::PENDING || slot.sequence != sequence) {
+                    return;
+                }
+                if (slot.retries == 0) {
+                    // round trips of frames written again are ambiguous
+                    this->sample(std::max(std::chrono::duration_cast<Duration>(now - slot.sentAt), Duration(0)));
+                }
+                slot.state = SlotState::FREE;
+                this->acknowledged++;
+            };
+            auto inWindow = [&](uint8_t sequence) {
+                return (uint8_t) (sequence - this->base) < inFlight;
+            };
+
+            for (uint8_t sequence = this->base; sequence != next; sequence++) {
+                acknowledge(sequence);
+            }
+            int highest = -1;
+            for (int i = 0; i < 32; i++) {
+                if (bitmap >> i & 1u && inWindow((uint8_t) (next + 1 + i))) {
+                    acknowledge((uint8_t) (next + 1 + i));
+                    highest = i;
+                }
+            }
+
+            // missing below a received frame, unless written again less than a round trip ago
+            Duration holdoff = this->measured
+                ? this->smoothedRoundTrip + this->roundTripVariance
+                : this->options.minTimeout;
+            for (int i = -1; i < highest; i++) {
+                auto sequence = (uint8_t) (next + 1 + i);
+                if ((i >= 0 && bitmap >> i & 1u) || !inWindow(sequence)) {
+                    continue;
+                }
+                Slot & slot = this->slots[sequence % MAX_WINDOW];
+                if (slot.state == SlotState::PENDING && !slot.nacked && now - slot.sentAt >= holdoff) {
+                    slot.nacked = true;
+                    nacked = true;
+                }
+            }
+            this->advanceBase();
+            this->takeRoomWaiters(resuming);
+        }
+        if (nacked) {
+            this->wakeTimer();
+        }
+        for (const RoomWaiter & waiter : resuming) {
+            waiter.resume(waiter.context);
+        }
+    }
+
+    func ReliableChannel::releaseHeld() -> void
+    {
+        while (this->heldMask & 1u) {
+            this->ready.push_back(std::move(this->heldFrames[this->expected % MAX_WINDOW]));
+            this->heldFrames[this->expected % MAX_WINDOW] = FrameBuffer();
+            this->expected++;
+            this->heldMask >>= 1;
+            this->delivered++;
+            this->unacknowledged++;
+        }
+    }
+
+    func ReliableChannel::skipGapLocked(Clock::time_point now) -> bool
+    {
+        if (this->heldMask == 0 || now - this->gapSince < this->options.gapTimeout) {
+            return false;
+        }
+        // the sender gave up on the missing ones
+        unsigned gap = lowestBit(this->heldMask);
+        this->skipped += gap;
+        this->expected += gap;
+        this->heldMask >>= gap;
+        this->releaseHeld();
+        this->gapSince = now;
+        return true;
+    }
+
+    func ReliableChannel::acknowledgementLocked(byte_t (& data)[ACK_SIZE]) -> void
+    {
+        uint32_t bitmap = this->heldMask >> 1;
+        data[0] = this->expected;
+        data[1] = (byte_t) (bitmap & 0xFF);
+        data[2] = (byte_t) (bitmap >> 8 & 0xFF);
+        data[3] = (byte_t) (bitmap >> 16 & 0xFF);
+        data[4] = (byte_t) (bitmap >> 24 & 0xFF);
+        this->unacknowledged = 0;
+        this->acksSent++;
+    }
+
+    func ReliableChannel::receive(const FrameView & frame) -> void
+    {
+        bool deliverFrame = false;
+        size_t frameAt = 0;          // position of the frame among the released ones
+        bool sendAck = false;
+        bool startTimer = false;
+        byte_t ack[ACK_SIZE];
+        Lock delivery(this->deliveryMutex);
+        if (!this->delivering) {
+            return;
+        }
+        {
+            Lock lock(this->receiverMutex);
+            Clock::time_point now = Clock::now();
+            sendAck = this->skipGapLocked(now);
+
+            auto distance = (uint8_t) (frame.sequence - this->expected);
+            if (distance == 0) {
+                deliverFrame = true;
+                frameAt = this->ready.size();
+                this->expected++;
+                this->heldMask >>= 1;
+                this->delivered++;
+                this->unacknowledged++;
+                this->releaseHeld();
+                if (this->ready.size() != frameAt) {
+                    this->gapSince = now;
+                    sendAck = true;
+                }
+            } else if (distance < MAX_WINDOW) {
+                if (this->heldMask >> distance & 1u) {
+                    this->duplicates++;
+                } else {
+                    if (this->heldMask == 0) {
+                        this->gapSince = now;
+                    }
+                    this->heldMask |= 1u << distance;
+                    FrameBuffer & slot = this->heldFrames[frame.sequence % MAX_WINDOW];
+                    if (frame.buffer != nullptr) {
+                        slot = *frame.buffer;
+                    } else {
+                        slot = this->pool->acquire(frame.dataLength);
+                        std::memcpy(slot.mutableData(), frame.data, frame.dataLength);
+                        slot.setHeader(frame.commandId, frame.sequence);
+                    }
+                    this->held++;
+                }
+                sendAck = true;
+            } else if (distance >= 128) {
+                // written again before our acknowledgement got through
+                this->duplicates++;
+                sendAck = true;
+            } else {
+                // too far ahead to be in the peer's window, it started over
+                this->resyncs++;
+                for (size_t i = 1; i < MAX_WINDOW; i++) {
+                    if (this->heldMask >> i & 1u) {
+                        FrameBuffer & slot = this->heldFrames[(uint8_t) (this->expected + i) % MAX_WINDOW];
+                        this->ready.push_back(std::move(slot));
+                        slot = FrameBuffer();
+                        this->delivered++;
+                    }
+                }
+                this->heldMask = 0;
+                this->expected = (uint8_t) (frame.sequence + 1);
+                deliverFrame = true;
+                frameAt = this->ready.size();
+                this->delivered++;
+                sendAck = true;
+            }
+
+            if (sendAck || this->unacknowledged >= this->options.ackEvery) {
+                this->acknowledgementLocked(ack);
+                sendAck = true;
+            } else if (this->unacknowledged == 1) {
+                this->ackDeadline = now + this->options.ackDelay;
+                startTimer = true;
+            }
+        }
+
+        for (size_t i = 0; i < this->ready.size(); i++) {
+            if (deliverFrame && i == frameAt) {
+                this->deliverer(frame);
+            }
+            FrameBuffer & buffer = this->ready[i];
+            this->deliverer(FrameView { buffer.commandId(), buffer.sequence(), (uint16_t) buffer.size(), buffer.data(), &buffer });
+        }
+        if (deliverFrame && frameAt == this->ready.size()) {
+            this->deliverer(frame);
+        }
+        this->ready.clear();
+        delivery.unlock();
+
+        if (sendAck) {
+            this->ackWriter(ack, ACK_SIZE);
+        } else if (startTimer) {
+            this->wakeTimer();
+        }
+    }
+
+    func ReliableChannel::releaseAfterGap(Clock::time_point now) -> void
+    {
+        byte_t ack[ACK_SIZE];
+        {
+            Lock delivery(this->deliveryMutex);
+            if (!this->delivering) {
+                return;
+            }
+            {
+                Lock lock(this->receiverMutex);
+                if (!this->skipGapLocked(now)) {
+                    return;  // released by a frame that arrived meanwhile
+                }
+                this->acknowledgementLocked(ack);
+            }
+            for (FrameBuffer & buffer : this->ready) {
+                this->deliverer(FrameView { buffer.commandId(), buffer.sequence(), (uint16_t) buffer.size(), buffer.data(), &buffer });
+            }
+            this->ready.clear();
+        }
+        this->ackWriter(ack, ACK_SIZE);
+    }
+
+    func ReliableChannel::stopDelivery() -> void
+    {
+        Lock delivery(this->deliveryMutex);
+        this->delivering = false;
+    }
+
+    func ReliableChannel::statistics() -> Statistics
+    {
+        Statistics statistics {};
+        {
+            Lock lock(this->senderMutex);
+            statistics.sent = this->sent;
+            statistics.retransmitted = this->retransmitted;
+            statistics.expired = this->expired;
+            statistics.acknowledged = this->acknowledged;
+            statistics.acksReceived = this->acksReceived;
+            statistics.inFlight = (uint8_t) (this->nextSequence - this->base);
+            statistics.waiting = this->waiting.size();
+            statistics.roomWaiters = this->roomWaiters.size();
+            statistics.roundTrip = this->smoothedRoundTrip;
+            statistics.timeout = this->timeout;
+        }
+        {
+            Lock lock(this->receiverMutex);
+            statistics.delivered = this->delivered;
+            statistics.duplicates = this->duplicates;
+            statistics.held = this->held;
+            statistics.skipped = this->skipped;
+            statistics.resyncs = this->resyncs;
+            statistics.acksSent = this->acksSent;
+        }
+        return statistics;
+    }
+
+    func ReliableChannel::timerDaemon() -> void
+    {
+        std::vector<Retransmission> retransmissions;
+        while (true) {
+            uint64_t seen;
+            {
+                Lock timer(this->timerMutex);
+                if (!this->running) {
+                    return;
+                }
+                seen = this->wakeups;
+            }
+
+            Clock::time_point now = Clock::now();
+            std::array<Duration, PrioritySender::LANES> backlogs {};
+            for (size_t i = 0; i < backlogs.size(); i++) {
+                backlogs[i] = this->backlog((Priority) i);
+            }
+            Clock::time_point wake;
+            {
+                Lock lock(this->senderMutex);
+                wake = this->collectRetransmissions(now, backlogs, retransmissions);
+            }
+            std::stable_sort(retransmissions.begin(), retransmissions.end(), [](const Retransmission & a, const Retransmission & b) {
+                return a.priority < b.priority;
+            });
+            for (Retransmission & retransmission : retransmissions) {
+                this->writer(retransmission.bytes.data(), retransmission.bytes.size(), wireLane(retransmission.priority));
+            }
+            retransmissions.clear();
+            this->drainWaiting();
+
+            bool sendAck = false;
+            bool gapExpired = false;
+            byte_t ack[ACK_SIZE];
+            {
+                Lock lock(this->receiverMutex);
+                if (this->heldMask != 0) {
+                    Clock::time_point giveUp = this->gapSince + this->options.gapTimeout;
+                    gapExpired = giveUp <= now;
+                    wake = std::min(wake, giveUp);
+                }
+                if (this->unacknowledged > 0) {
+                    if (this->ackDeadline <= now) {
+                        this->acknowledgementLocked(ack);
+                        sendAck = true;
+                    } else {
+                        wake = std::min(wake, this->ackDeadline);
+                    }
+                }
+            }
+            if (gapExpired) {
+                // nothing arrived that would release the frames held behind it
+                this->releaseAfterGap(now);
+            }
+            if (sendAck) {
+                this->ackWriter(ack, ACK_SIZE);
+            }
+
+            Lock timer(this->timerMutex);
+            this->timerWakeup.wait_until(timer, wake, [&] {
+                return !this->running || this->wakeups != seen;
+            });
+        }
+    }
+}
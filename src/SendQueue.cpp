@@ -0,0 +1,256 @@
+#include "serial/SendQueue.hpp"
+#include "serial/utils/Logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#define func auto
+
+using namespace std::literals::chrono_literals;
+
+namespace serial
+{
+    static func roundUpPowerOfTwo(size_t value) -> size_t
+    {
+        size_t power = 1;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    SendQueue::SendQueue(Sink sink, const Options & options) : sink(std::move(sink)), options(options)
+    {
+        size_t capacity = roundUpPowerOfTwo(options.capacity < 2 ? 2 : options.capacity);
+        this->options.capacity = capacity;
+        if (this->options.maxGather < 1) {
+            this->options.maxGather = 1;
+        }
+        this->mask = capacity - 1;
+        this->slots = std::make_unique<Slot[]>(capacity);
+        for (size_t i = 0; i < capacity; i++) {
+            this->slots[i].sequence.store(i, std::memory_order_relaxed);
+            this->slots[i].data.reserve(options.slotReserve);
+        }
+        this->writerThread = std::thread(&SendQueue::writerDaemon, this);
+    }
+
+    SendQueue::~SendQueue()
+    {
+        this->running.store(false);
+        {
+            Lock lock(this->waitMutex);
+            this->stateChanged.notify_all();
+        }
+        if (this->writerThread.joinable()) {
+            this->writerThread.join();
+        }
+    }
+
+    func SendQueue::claimEnqueue(size_t & position) -> Slot*
+    {
+        while (true) {
+            size_t pos = this->enqueuePos.load(std::memory_order_relaxed);
+            while (true) {
+                Slot & slot = this->slots[pos & this->mask];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                auto diff = (intptr_t) sequence - (intptr_t) pos;
+                if (diff == 0) {
+                    if (this->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        size_t depth = pos + 1 - this->dequeuePos.load(std::memory_order_relaxed);
+                        size_t observed = this->maxDepth.load(std::memory_order_relaxed);
+                        while (depth > observed && !this->maxDepth.compare_exchange_weak(observed, depth)) {}
+                        position = pos;
+                        return &slot;
+                    }
+                } else if (diff < 0) {
+                    break;  // full
+                } else {
+                    pos = this->enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            switch (this->options.overflow) {
+
+                case OverflowPolicy::DROP_NEWEST:
+                {
+                    this->droppedNewest++;
+                    return nullptr;
+                }
+
+                case OverflowPolicy::DROP_OLDEST:
+                {
+                    size_t oldest;
+                    Slot* slot = this->claimDequeue(oldest);
+                    if (slot != nullptr) {
+                        this->release(slot, oldest);
+                        this->droppedOldest++;
+                    } else {
+                        // everything queued is being written right now
+                        std::this_thread::yield();
+                    }
+                }
+                break;
+
+                case OverflowPolicy::BLOCK:
+                {
+                    if (!this->running) {
+                        this->droppedNewest++;
+                        return nullptr;
+                    }
+                    this->waiters++;
+                    {
+                        Lock lock(this->waitMutex);
+                        this->stateChanged.wait_for(lock, 1ms);
+                    }
+                    this->waiters--;
+                }
+                break;
+            }
+        }
+    }
+
+    func SendQueue::claimDequeue(size_t & position) -> Slot*
+    {
+        size_t pos = this->dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot & slot = this->slots[pos & this->mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+            if (diff == 0) {
+                if (this->dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    position = pos;
+                    return &slot;
+                }
+            } else if (diff < 0) {
+                return nullptr;  // empty
+            } else {
+                pos = this->dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    func SendQueue::release(Slot* slot, size_t position) -> void
+    {
+        slot->sequence.store(position + this->mask + 1, std::memory_order_release);
+    }
+
+    func SendQueue::hasReady() -> bool
+    {
+        size_t pos = this->dequeuePos.load(std::memory_order_relaxed);
+        return this->slots[pos & this->mask].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    func SendQueue::notifyWriter() -> void
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (this->writerParked.load(std::memory_order_relaxed)) {
+            Lock lock(this->waitMutex);
+            this->stateChanged.notify_all();
+        }
+    }
+
+    func SendQueue::push(const void* data, size_t size) -> bool
+    {
+        const auto* bytes = static_cast<const byte_t*>(data);
+        return this->emplace(size, [&](byte_t* buffer) {
+            std::copy(bytes, bytes + size, buffer);
+        });
+    }
+
+    func SendQueue::flush() -> void
+    {
+        size_t ticket = this->enqueuePos.load();
+        this->waiters++;
+        {
+            Lock lock(this->waitMutex);
+            while (this->running && (this->dequeuePos.load() < ticket || this->writing.load())) {
+                this->stateChanged.wait_for(lock, 1ms);
+            }
+        }
+        this->waiters--;
+    }
+
+    func SendQueue::depth() const -> size_t
+    {
+        return this->enqueuePos.load(std::memory_order_relaxed) - this->dequeuePos.load(std::memory_order_relaxed);
+    }
+
+    func SendQueue::statistics() const -> Statistics
+    {
+        return Statistics {
+            this->enqueuePos.load(),
+            this->written.load(),
+            this->droppedOldest.load(),
+            this->droppedNewest.load(),
+            this->writeFailures.load(),
+            this->depth(),
+            this->maxDepth.load(),
+        };
+    }
+
+    func SendQueue::writerDaemon() -> void
+    {
+        const int maxGather = this->options.maxGather;
+        std::vector<Slot*> claimed(maxGather);
+        std::vector<size_t> positions(maxGather);
+        std::vector<struct iovec> buffers(maxGather);
+
+        while (true) {
+
+            int count = 0;
+            size_t total = 0;
+            this->writing.store(true);
+
+            Slot* slot;
+            while (count < maxGather && (slot = this->claimDequeue(positions[count])) != nullptr) {
+                claimed[count] = slot;
+                buffers[count] = { slot->data.data(), slot->data.size() };
+                total += slot->data.size();
+                count++;
+            }
+
+            if (count == 0) {
+                this->writing.store(false);
+                if (this->waiters.load() > 0) {
+                    Lock lock(this->waitMutex);
+                    this->stateChanged.notify_all();
+                }
+                if (!this->running) {
+                    return;
+                }
+                this->writerParked.store(true);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!this->hasReady()) {
+                    Lock lock(this->waitMutex);
+                    this->stateChanged.wait_for(lock, 10ms, [this] {
+                        return this->hasReady() || !this->running;
+                    });
+                }
+                this->writerParked.store(false);
+                continue;
+            }
+
+            try {
+                if (this->sink(buffers.data(), count) != (int) total) {
+                    this->writeFailures++;
+                }
+            } catch (std::exception & exception) {
+                static logger::RateLimiter limiter;
+                logger::error(limiter, "Asynchronous send failed: ", exception.what());
+                this->writeFailures++;
+            }
+
+            for (int i = 0; i < count; i++) {
+                this->release(claimed[i], positions[i]);
+            }
+            this->written += count;
+            this->writing.store(false);
+
+            if (this->waiters.load() > 0) {
+                Lock lock(this->waitMutex);
+                this->stateChanged.notify_all();
+            }
+        }
+    }
+}
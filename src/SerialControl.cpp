@@ -1,13 +1,16 @@
 #include "serial/SerialControl.hpp"
+#include "serial/Capture.hpp"
 #include "serial/utils/Logger.hpp"
 
+#include <cerrno>
 #include <cstring>
 #include <cstdlib>
 
 #include <unistd.h>  /* UNIX standard function definitions */
 #include <fcntl.h>   /* File control definitions */
 
-#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
 
 #define func auto
 
@@ -56,12 +59,6 @@ func openPort(const char* tty, int cflag, int iflag, int oflag, int lflag) -> in
 #define ADD_FLAG(dst, src)  dst |= (src)
 #define RM_FLAG(dst, src)   dst &= ~(src)
 
-inline func fileAccessible(int fd) -> bool
-{
-    struct stat buf {};
-    return fstat(fd, &buf) == 0 && buf.st_nlink >= 1;
-}
-
 inline func _baud(int baudRate) -> int
 {
     if (baudRate < B0) return -1;
@@ -117,42 +114,91 @@ namespace serial
         this->open(tty, baudRate, flags);
     }
 
+    SerialControl::SerialControl(const SerialControl & another)
+        : fileDescriptor(another.fileDescriptor.load()),
+          connected(another.connected.load()),
+          emptyReadIsHangUp(another.emptyReadIsHangUp.load()),
+          capture(another.capture.load())
+    {}
+
+    func SerialControl::operator=(const SerialControl & another) -> SerialControl &
+    {
+        this->fileDescriptor = another.fileDescriptor.load();
+        this->connected = another.connected.load();
+        this->emptyReadIsHangUp = another.emptyReadIsHangUp.load();
+        this->capture = another.capture.load();
+        return *this;
+    }
+
     func SerialControl::open(const String & ttyPathname, int baudRate, int cflag, int iflag, int oflag, int lflag) -> bool
     {
         if ((baudRate = BAUD(baudRate)) == -1) return false;
         this->fileDescriptor = ::openPort(ttyPathname.c_str(), baudRate | cflag, iflag, oflag, lflag);
-        return this->fileDescriptor != -1;
+        this->emptyReadIsHangUp = true;
+        this->connected = this->fileDescriptor != -1;
+        return this->connected;
     }
 
-    func SerialControl::send(void* data, size_t size) const -> int
+    func SerialControl::lost(int error) const -> bool
     {
-        if (!this->isOpen()) {
-            throw SerialClosedException();
+        switch (error) {
+            case EIO:
+            case EBADF:
+            case ENXIO:
+            case ENODEV:
+            case EPIPE:
+                this->connected.store(false, std::memory_order_relaxed);
+                return true;
+            default:
+                return false;
         }
-        ssize_t bytesWritten = ::write(this->fileDescriptor, data, size);
-        return bytesWritten == -1 ? 0 : (int) bytesWritten;
     }
 
-    template<typename T>
-    func SerialControl::send(T* data) const -> int
+    func SerialControl::send(const void* data, size_t size) const -> int
     {
-        return this->send(data, sizeof(T));
-    }
-
-    template<typename T>
-    func SerialControl::send(const T & data) const -> int
-    {
-        return this->send(&data, sizeof(T));
+        if (!this->isOpen()) {
+            throw SerialClosedException();
+        }
+        ssize_t bytesWritten = ::write(this->fileDescriptor, data, size);
+        if (bytesWritten == -1) {
+            if (this->lost(errno)) {
+                throw SerialClosedException();
+            }
+            return 0;
+        }
+        CaptureWriter* writer = this->capture.load(std::memory_order_acquire);
+        if (writer != nullptr) {
+            writer->record(CaptureDirection::SENT, data, (size_t) bytesWritten);
+        }
+        return (int) bytesWritten;
     }
 
-    func SerialControl::isOpen() const -> bool
+    func SerialControl::send(const struct iovec* buffers, int count) const -> int
     {
-        return ::fileAccessible(this->fileDescriptor);
+        if (!this->isOpen()) {
+            throw SerialClosedException();
+        }
+        ssize_t bytesWritten = ::writev(this->fileDescriptor, buffers, count);
+        if (bytesWritten == -1) {
+            if (this->lost(errno)) {
+                throw SerialClosedException();
+            }
+            return 0;
+        }
+        CaptureWriter* writer = this->capture.load(std::memory_order_acquire);
+        if (writer != nullptr) {
+            writer->record(CaptureDirection::SENT, buffers, count, (size_t) bytesWritten);
+        }
+        return (int) bytesWritten;
     }
 
-    func SerialControl::close() const -> void
+    func SerialControl::close() -> void
     {
-        ::close(this->fileDescriptor);
+        this->connected = false;
+        int fd = this->fileDescriptor.exchange(-1);
+        if (fd != -1) {
+            ::close(fd);
+        }
     }
 
     func SerialControl::setBaudRate(int baud) const -> void
@@ -168,6 +214,35 @@ namespace serial
         ::tcsetattr(this->fileDescriptor, TCSANOW, &options);
     }
 
+    func SerialControl::setReadTimeouts(uint8_t vmin, uint8_t vtime) const -> bool
+    {
+        termios options {};
+        if (::tcgetattr(this->fileDescriptor, &options) != 0) {
+            return false;
+        }
+        options.c_cc[VMIN] = vmin;
+        options.c_cc[VTIME] = vtime;
+        if (::tcsetattr(this->fileDescriptor, TCSANOW, &options) != 0) {
+            return false;
+        }
+        this->emptyReadIsHangUp = vmin > 0;
+        return true;
+    }
+
+    func SerialControl::setLowLatency(bool value) const -> bool
+    {
+        struct serial_struct serialInfo {};
+        if (::ioctl(this->fileDescriptor, TIOCGSERIAL, &serialInfo) != 0) {
+            return false;
+        }
+        if (value) {
+            ADD_FLAG(serialInfo.flags, ASYNC_LOW_LATENCY);
+        } else {
+            RM_FLAG(serialInfo.flags, ASYNC_LOW_LATENCY);
+        }
+        return ::ioctl(this->fileDescriptor, TIOCSSERIAL, &serialInfo) == 0;
+    }
+
     func SerialControl::addFlag(int flag) const -> void
     {
         termios options {};
@@ -193,12 +268,24 @@ namespace serial
         if (!this->isOpen()) {
             throw SerialClosedException();
         }
-        return (int) read(this->fileDescriptor, data, size);
+        ssize_t bytesRead = ::read(this->fileDescriptor, data, size);
+        if (bytesRead > 0) {
+            CaptureWriter* writer = this->capture.load(std::memory_order_acquire);
+            if (writer != nullptr) {
+                writer->record(CaptureDirection::RECEIVED, data, (size_t) bytesRead);
+            }
+            return (int) bytesRead;
+        }
+        if (bytesRead == 0 ? this->emptyReadIsHangUp.load(std::memory_order_relaxed) : this->lost(errno)) {
+            this->connected.store(false, std::memory_order_relaxed);
+            throw SerialClosedException();
+        }
+        return (int) bytesRead;
     }
 
     func SerialControl::send(const std::vector<unsigned char> & data) const -> int
     {
-        return this->send((void*) data.data(), data.size());
+        return this->send((const void*) data.data(), data.size());
     }
 
     func SerialControl::receive(size_t size) const -> std::vector<byte_t>
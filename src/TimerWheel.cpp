@@ -0,0 +1,121 @@
+#include "serial/TimerWheel.hpp"
+#include "serial/utils/Logger.hpp"
+
+#include <algorithm>
+
+#define func auto
+
+namespace serial
+{
+    TimerWheel::TimerWheel(Expire expire, const Options & options) : expire(std::move(expire)), options(options)
+    {
+        if (this->options.tick.count() < 1) {
+            this->options.tick = Duration(1);
+        }
+        if (this->options.slots < 1) {
+            this->options.slots = 1;
+        }
+        this->slots.resize(this->options.slots);
+        this->start = Clock::now();
+        this->wheelThread = std::thread(&TimerWheel::wheelDaemon, this);
+    }
+
+    TimerWheel::~TimerWheel()
+    {
+        {
+            Lock lock(this->mutex);
+            this->running = false;
+        }
+        this->wakeup.notify_all();
+        if (this->wheelThread.joinable()) {
+            this->wheelThread.join();
+        }
+    }
+
+    func TimerWheel::ticksSinceStart(Clock::time_point time) const -> uint64_t
+    {
+        return (uint64_t) (std::chrono::duration_cast<Duration>(time - this->start) / this->options.tick);
+    }
+
+    func TimerWheel::schedule(uint64_t id, Duration delay) -> void
+    {
+        Clock::time_point now = Clock::now();
+        bool wasEmpty;
+        {
+            Lock lock(this->mutex);
+            wasEmpty = this->pending == 0;
+            if (wasEmpty) {
+                // the thread stopped turning, nothing in the ticks it missed
+                this->current = this->ticksSinceStart(now);
+            }
+            // the first tick handled at or after the deadline
+            uint64_t target = std::max(this->ticksSinceStart(now + delay) + 1, this->current + 1);
+            uint64_t turns = (target - this->current - 1) / this->options.slots;
+            this->slots[target % this->options.slots].push_back(Timer { id, turns });
+            this->pending++;
+        }
+        if (wasEmpty) {
+            this->wakeup.notify_one();
+        }
+    }
+
+    func TimerWheel::size() -> size_t
+    {
+        Lock lock(this->mutex);
+        return this->pending;
+    }
+
+    func TimerWheel::wheelDaemon() -> void
+    {
+        std::vector<uint64_t> expired;
+        Lock lock(this->mutex);
+        while (true) {
+            if (!this->running) {
+                return;
+            }
+            if (this->pending == 0) {
+                this->wakeup.wait(lock);
+                continue;
+            }
+
+            Clock::time_point next = this->start + (this->current + 1) * this->options.tick;
+            if (Clock::now() < next) {
+                this->wakeup.wait_until(lock, next);
+                continue;
+            }
+
+            // catch up on every tick that passed
+            uint64_t now = this->ticksSinceStart(Clock::now());
+            while (this->current < now) {
+                this->current++;
+                std::vector<Timer> & slot = this->slots[this->current % this->options.slots];
+                size_t kept = 0;
+                for (Timer & timer : slot) {
+                    if (timer.turns == 0) {
+                        expired.push_back(timer.id);
+                        continue;
+                    }
+                    timer.turns--;
+                    slot[kept++] = timer;
+                }
+                this->pending -= slot.size() - kept;
+                slot.resize(kept);
+            }
+            if (expired.empty()) {
+                continue;
+            }
+
+            lock.unlock();
+            for (uint64_t id : expired) {
+                try {
+                    this->expire(id);
+                } catch (std::exception & exception) {
+                    static logger::RateLimiter limiter;
+                    logger::error(limiter, "Timer callback threw: ", exception.what());
+                }
+            }
+            expired.clear();
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#include "serial/WriteCoalescer.hpp"
+#include "serial/utils/Logger.hpp"
+
+#define func auto
+
+namespace serial
+{
+    WriteCoalescer::WriteCoalescer(Sink sink, size_t maxBytes, Duration maxDelay)
+        : sink(std::move(sink)), maxBytes(maxBytes), maxDelay(maxDelay)
+    {
+        this->buffer.reserve(maxBytes);
+        this->flushThread = std::thread(&WriteCoalescer::flushDaemon, this);
+    }
+
+    WriteCoalescer::~WriteCoalescer()
+    {
+        {
+            Lock lock(this->mutex);
+            this->running = false;
+            try {
+                this->flushLocked();
+            } catch (std::exception & exception) {
+                // the port is gone, an exception must not leave a destructor
+                static logger::RateLimiter limiter;
+                logger::warning(limiter, "Coalesced frames dropped at teardown: ", exception.what());
+            }
+        }
+        this->wakeup.notify_all();
+        if (this->flushThread.joinable()) {
+            this->flushThread.join();
+        }
+    }
+
+    func WriteCoalescer::append(const void* frame, size_t size) -> bool
+    {
+        const auto* bytes = static_cast<const byte_t*>(frame);
+        Lock lock(this->mutex);
+
+        if (this->buffer.size() + size > this->maxBytes) {
+            // pending frames and the new one leave together in one writev
+            size_t total = this->buffer.size() + size;
+            return this->flushLocked(bytes, size) == (int) total;
+        }
+
+        bool wasEmpty = this->buffer.empty();
+        this->buffer.insert(this->buffer.end(), bytes, bytes + size);
+
+        if (this->buffer.size() == this->maxBytes) {
+            size_t total = this->buffer.size();
+            return this->flushLocked() == (int) total;
+        }
+
+        if (wasEmpty) {
+            this->deadline = Clock::now() + this->maxDelay;
+            lock.unlock();
+            this->wakeup.notify_one();
+        }
+        return true;
+    }
+
+    func WriteCoalescer::flush() -> int
+    {
+        Lock lock(this->mutex);
+        return this->flushLocked();
+    }
+
+    func WriteCoalescer::pending() -> size_t
+    {
+        Lock lock(this->mutex);
+        return this->buffer.size();
+    }
+
+    func WriteCoalescer::flushLocked(const byte_t* extra, size_t extraSize) -> int
+    {
+        struct iovec buffers[2];
+        int count = 0;
+        if (!this->buffer.empty()) {
+            buffers[count++] = { this->buffer.data(), this->buffer.size() };
+        }
+        if (extra != nullptr && extraSize > 0) {
+            buffers[count++] = { const_cast<byte_t*>(extra), extraSize };
+        }
+        if (count == 0) {
+            return 0;
+        }
+        int sent;
+        try {
+            sent = this->sink(buffers, count);
+        } catch (...) {
+            this->buffer.clear();
+            throw;
+        }
+        this->buffer.clear();
+        return sent;
+    }
+
+    func WriteCoalescer::flushDaemon() -> void
+    {
+        Lock lock(this->mutex);
+        while (this->running) {
+            if (this->buffer.empty()) {
+                this->wakeup.wait(lock);
+            } else if (Clock::now() >= this->deadline) {
+                try {
+                    this->flushLocked();
+                } catch (std::exception &) {
+                    // the sink already reported it, the next write will surface it again
+                }
+            } else {
+                this->wakeup.wait_until(lock, this->deadline);
+            }
+        }
+    }
+}
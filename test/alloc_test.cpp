@@ -0,0 +1,210 @@
+/**
+ * Publishing and receiving must not touch the heap once warmed up:
+ * counts every `operator new` while frames are encoded, published,
+ * decoded into pooled buffers and dispatched, directly and through a
+ * CommHandle over a pseudo terminal that echoes every byte.
+ */
+
+#include "serial/CommHandle.hpp"
+#include "serial/command/CommandFrame.hpp"
+#include "serial/command/DispatchTable.hpp"
+#include "serial/command/FrameDecoder.hpp"
+#include "serial/command/FramePool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include <pty.h>
+#include <unistd.h>
+
+#define func auto
+
+using namespace serial;
+using namespace serial::command;
+using namespace std::literals::chrono_literals;
+
+static std::atomic<size_t> allocations { 0 };
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t align = (size_t) alignment;
+    if (void* memory = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+struct Setpoint
+{
+    uint32_t id;
+    float values[6];
+};
+
+static constexpr uint16_t COMMAND = 0x0042;
+static constexpr size_t WARMUP = 200;
+static constexpr size_t FRAMES = 10000;
+
+static int failures = 0;
+
+func expectNone(const char* name, size_t counted) -> void
+{
+    std::printf("%s: %zu allocations\n", name, counted);
+    if (counted != 0) {
+        failures++;
+    }
+}
+
+func encodeAndDispatch() -> void
+{
+    static byte_t stream[FRAMES * sizeof(RawCommandFrame<Setpoint>)];
+    static size_t received = 0;
+
+    FramePool pool;
+    FrameDecoder decoder(0xA5, UINT16_MAX, &pool);
+    DispatchTable table;
+    table.set(COMMAND, [](void*, const FrameView & frame) {
+        received += reinterpret_cast<const Setpoint*>(frame.data)->id == 7;
+    }, nullptr, sizeof(Setpoint));
+
+    auto run = [&](size_t frames) {
+        size_t used = 0;
+        for (size_t i = 0; i < frames; i++) {
+            CommandFrame<Setpoint> frame(COMMAND, Setpoint { 7, {} }, 0xA5, (uint8_t) i);
+            used += frame.encode(stream + used, sizeof(stream) - used);
+        }
+        // odd chunks, so frames are cut and carried over
+        FrameView view {};
+        for (size_t offset = 0; offset < used; offset += 61) {
+            decoder.feed(stream + offset, std::min<size_t>(61, used - offset));
+            while (decoder.next(view)) {
+                const DispatchTable::Entry & entry = table.find(view.commandId);
+                entry.invoke(entry.target, view);
+            }
+        }
+    };
+
+    run(WARMUP);
+    size_t before = allocations.load();
+    run(FRAMES);
+    expectNone("encode, decode and dispatch", allocations.load() - before);
+    if (received != WARMUP + FRAMES) {
+        std::printf("decoded %zu of %zu frames\n", received, WARMUP + FRAMES);
+        failures++;
+    }
+}
+
+func publishAndReceive() -> void
+{
+    int master, slave;
+    char name[256];
+    if (openpty(&master, &slave, name, nullptr, nullptr) != 0) {
+        std::printf("no pseudo terminal, skipped\n");
+        return;
+    }
+    struct termios settings {};
+    tcgetattr(master, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(master, TCSANOW, &settings);
+
+    std::thread echo([master] {
+        byte_t buffer[512];
+        ssize_t count;
+        while ((count = read(master, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t written = 0; written < count; ) {
+                ssize_t result = write(master, buffer + written, (size_t) (count - written));
+                if (result <= 0) {
+                    return;
+                }
+                written += result;
+            }
+        }
+    });
+    echo.detach();
+
+    SerialControl port;
+    if (!port.open(name, B115200)) {
+        std::printf("cannot open %s\n", name);
+        failures++;
+        return;
+    }
+    static std::atomic<size_t> received { 0 };
+    CommHandle comm(port);
+    comm.subscribe<COMMAND, Setpoint>([](const Setpoint &) {
+        received.fetch_add(1, std::memory_order_relaxed);
+    });
+    auto publisher = comm.advertise<COMMAND, Setpoint>();
+    comm.startReceivingAsync();
+
+    auto run = [&](size_t frames) {
+        size_t wanted = received.load() + frames;
+        for (size_t i = 0; i < frames; i++) {
+            publisher.publish(Setpoint { (uint32_t) i, {} });
+        }
+        auto deadline = std::chrono::steady_clock::now() + 10s;
+        while (received.load() < wanted && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        return received.load() >= wanted;
+    };
+
+    run(WARMUP);
+    size_t before = allocations.load();
+    bool complete = run(FRAMES);
+    expectNone("publish and receive through CommHandle", allocations.load() - before);
+    if (!complete) {
+        std::printf("received %zu of %zu frames\n", received.load(), WARMUP + FRAMES);
+        failures++;
+    }
+    comm.stopReceiving();
+}
+
+int main()
+{
+    size_t before = allocations.load();
+    // a direct call, new expressions may be elided
+    ::operator delete(::operator new(1));
+    if (allocations.load() == before) {
+        std::printf("operator new is not counted\n");
+        return 1;
+    }
+    encodeAndDispatch();
+    publishAndReceive();
+    std::fflush(stdout);
+    // the echo thread still blocks in read
+    _exit(failures == 0 ? 0 : 1);
+}
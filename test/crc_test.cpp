@@ -0,0 +1,94 @@
+/**
+ * Every CRC engine must agree with the bitwise reference: the slice-by-8
+ * tables, the carry-less multiply folding when the CPU has it, and the
+ * `compute` dispatch between them, over every length up to a few
+ * kilobytes and at unaligned offsets.
+ */
+
+#include "serial/command/CRC.hpp"
+#include "serial/command/CommandFrame.hpp"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#define func auto
+
+using namespace serial::command;
+
+static constexpr size_t MAX_LENGTH = 2100;
+static constexpr size_t OFFSETS = 8;
+
+static int failures = 0;
+
+// folding is only built for reflected input of the table driven widths
+template <typename Crc>
+struct Foldable;
+
+template <byte_t width, uint32_t polynomial, uint32_t initialXOR, uint32_t finalXOR, bool reflectData, bool reflectRemainder>
+struct Foldable<CRC<width, polynomial, initialXOR, finalXOR, reflectData, reflectRemainder>>
+{
+    static constexpr bool value = reflectData && width >= 8 && width <= 32;
+};
+
+template <typename Crc>
+func check(const char* name, const std::vector<byte_t> & bytes, uint64_t expected) -> void
+{
+    static const byte_t* check = reinterpret_cast<const byte_t*>("123456789");
+    if (Crc::computeBitwise(check, 9) != expected || Crc::compute(check, 9) != expected) {
+        std::printf("%s: check value %llx, expected %llx\n", name, (unsigned long long) Crc::compute(check, 9),
+                    (unsigned long long) expected);
+        failures++;
+    }
+
+    for (size_t offset = 0; offset < OFFSETS; offset++) {
+        const byte_t* data = bytes.data() + offset;
+        typename Crc::BitwiseIterator bitwise;
+        for (size_t length = 0; length <= MAX_LENGTH; length++) {
+            if (length > 0) {
+                bitwise.computeNext(data[length - 1]);
+            }
+            uint64_t reference = bitwise.getValue();
+            uint64_t table = Crc::computeTable(data, length);
+            uint64_t dispatched = Crc::compute(data, length);
+            uint64_t folded = reference;
+            if constexpr (Foldable<Crc>::value) {
+                if (CrcFolding::available) {
+                    folded = Crc::computeFolded(data, length);
+                }
+            }
+            if (table != reference || dispatched != reference || folded != reference) {
+                std::printf("%s: length %zu offset %zu bitwise %llx table %llx folded %llx compute %llx\n",
+                            name, length, offset, (unsigned long long) reference, (unsigned long long) table,
+                            (unsigned long long) folded, (unsigned long long) dispatched);
+                if (++failures > 20) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 random(42);
+    std::vector<byte_t> bytes(MAX_LENGTH + OFFSETS);
+    for (byte_t & byte : bytes) {
+        byte = (byte_t) random();
+    }
+
+    // the frame CRCs, then reflected and non-reflected variants of each width
+    check<CommandFrameUtils::Crc8>("frame CRC-8", bytes, 0x0B);
+    check<CommandFrameUtils::Crc16>("frame CRC-16 (MCRF4XX)", bytes, 0x6F91);
+    check<CRC8<0x31, 0xFF, 0x00, false, false>>("CRC-8/NRSC-5", bytes, 0xF7);
+    check<CRC16<0x1021, 0xFFFF, 0x0000, false, false>>("CRC-16/CCITT-FALSE", bytes, 0x29B1);
+    check<CRC8<0x07, 0xFF, 0x00>>("CRC-8/ROHC", bytes, 0xD0);
+    check<CRC16<0x8005, 0x0000, 0x0000>>("CRC-16/ARC", bytes, 0xBB3D);
+    check<CRC16<0x1021, 0x0000, 0x0000>>("CRC-16/KERMIT", bytes, 0x2189);
+    check<CRC<32, 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF>>("CRC-32", bytes, 0xCBF43926);
+    check<CRC<32, 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF>>("CRC-32C", bytes, 0xE3069283);
+    check<CRC<32, 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, false, false>>("CRC-32/BZIP2", bytes, 0xFC891918);
+
+    std::printf("folding %s, %d failures\n", CrcFolding::available ? "available" : "not available", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/**
+ * Delta mode must reproduce every value on the receiving side, also for
+ * values barely longer than the delta header, where a delta is easily as
+ * long as the keyframe it would be mistaken for, and when a publish goes
+ * through a `PublishBatch` between deltas of a CommHandle.
+ */
+
+#include "serial/CommHandle.hpp"
+#include "serial/command/DeltaCodec.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <pty.h>
+#include <unistd.h>
+
+#define func auto
+
+using namespace serial;
+using namespace serial::command;
+using namespace std::literals::chrono_literals;
+
+static constexpr size_t FRAMES = 2000;
+
+static int failures = 0;
+
+func roundTrip(size_t size) -> void
+{
+    DeltaOptions options;
+    options.keyframeInterval = 20;
+    options.keyframePeriod = std::chrono::hours(1);
+    DeltaEncoder encoder(size, options);
+    DeltaDecoder decoder(size);
+
+    std::mt19937 random((uint32_t) size);
+    std::vector<byte_t> value(size);
+    size_t keyframes = 0, deltas = 0;
+
+    for (size_t frame = 0; frame < FRAMES; frame++) {
+        // mostly unchanged values and single byte changes, sometimes all new
+        switch (random() % 4) {
+            case 0:
+                break;
+            case 1:
+            case 2:
+                value[random() % size] = (byte_t) random();
+                break;
+            default:
+                for (byte_t & byte : value) {
+                    byte = (byte_t) random();
+                }
+        }
+
+        Span<byte_t> payload = encoder.encode(value.data());
+        if (encoder.wasKeyframe() != (payload.size() == size)) {
+            std::printf("size %zu frame %zu: %zu byte payload, keyframe %d\n",
+                        size, frame, payload.size(), encoder.wasKeyframe());
+            failures++;
+        }
+        DeltaDecoder::Result result = decoder.decode(payload.data(), payload.size());
+        bool expected = result == (encoder.wasKeyframe() ? DeltaDecoder::Result::KEYFRAME : DeltaDecoder::Result::DELTA);
+        if (!expected || std::memcmp(decoder.value(), value.data(), size) != 0) {
+            std::printf("size %zu frame %zu: decoded %d, value %s\n", size, frame, (int) result,
+                        std::memcmp(decoder.value(), value.data(), size) == 0 ? "equal" : "differs");
+            if (++failures > 20) {
+                return;
+            }
+        }
+        (encoder.wasKeyframe() ? keyframes : deltas)++;
+    }
+    std::printf("size %zu: %zu keyframes, %zu deltas\n", size, keyframes, deltas);
+}
+
+struct Telemetry
+{
+    uint32_t tick;
+    float values[7];
+};
+
+static constexpr uint16_t TELEMETRY = 0x0040;
+
+func batchedBetweenDeltas() -> void
+{
+    int master, slave;
+    char name[256];
+    if (openpty(&master, &slave, name, nullptr, nullptr) != 0) {
+        std::printf("no pseudo terminal, skipped\n");
+        return;
+    }
+    struct termios settings {};
+    tcgetattr(master, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(master, TCSANOW, &settings);
+
+    // the handle receives what it publishes
+    std::thread echo([master] {
+        byte_t buffer[512];
+        ssize_t count;
+        while ((count = read(master, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t written = 0; written < count; ) {
+                ssize_t result = write(master, buffer + written, (size_t) (count - written));
+                if (result <= 0) {
+                    return;
+                }
+                written += result;
+            }
+        }
+    });
+    echo.detach();
+
+    SerialControl port;
+    if (!port.open(name, B115200)) {
+        std::printf("cannot open %s\n", name);
+        failures++;
+        return;
+    }
+    static std::vector<uint32_t> received;
+    static std::atomic<size_t> count { 0 };
+    CommHandle comm(port);
+    DeltaOptions options;
+    options.keyframeInterval = 1000;
+    options.keyframePeriod = std::chrono::hours(1);
+    comm.enableDelta<TELEMETRY, Telemetry>(options);
+    comm.subscribe<TELEMETRY, Telemetry>([](const Telemetry & telemetry) {
+        received.push_back(telemetry.tick);
+        count.fetch_add(1, std::memory_order_release);
+    });
+    auto publisher = comm.advertise<TELEMETRY, Telemetry>();
+    comm.startReceivingAsync();
+
+    Telemetry telemetry {};
+    std::vector<uint32_t> published;
+    auto next = [&] {
+        telemetry.tick++;
+        published.push_back(telemetry.tick);
+        return telemetry;
+    };
+
+    for (int i = 0; i < 5; i++) {
+        publisher.publish(next());
+    }
+    {
+        auto batch = comm.batch();
+        batch.add(publisher, next());
+        // published before the batch is flushed, must still leave after it
+        publisher.publish(next());
+        batch.add(publisher, next());
+        batch.flush();
+    }
+    for (int i = 0; i < 5; i++) {
+        publisher.publish(next());
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (count.load(std::memory_order_acquire) < published.size() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    comm.stopReceiving();
+
+    CommHandle::DeltaStatistics stats = comm.deltaStatistics(TELEMETRY);
+    std::printf("batched between deltas: %zu of %zu values, %llu keyframes, %llu deltas, %llu dropped\n",
+                received.size(), published.size(), (unsigned long long) stats.keyframesReceived,
+                (unsigned long long) stats.deltasReceived, (unsigned long long) stats.dropped);
+    if (received != published || stats.dropped != 0 || stats.keyframesReceived != 1) {
+        failures++;
+    }
+}
+
+int main()
+{
+    for (size_t size : { 1, 2, 3, 4, 16, 300 }) {
+        roundTrip(size);
+    }
+    batchedBetweenDeltas();
+    std::printf("%d failures\n", failures);
+    std::fflush(stdout);
+    // the echo thread still blocks in read
+    _exit(failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,60 @@
+/**
+ * Strings reach the log line whatever form they are passed in: literals,
+ * char buffers filled at run time, including one without a terminating
+ * NUL, and pointers, null ones printed as "(null)".
+ */
+
+#include "serial/utils/Logger.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#define func auto
+
+static int failures = 0;
+
+// log calls are written to std::cerr on the calling thread unless async
+template <typename ... Ts>
+func logged(const Ts &... args) -> std::string
+{
+    std::ostringstream captured;
+    std::streambuf* previous = std::cerr.rdbuf(captured.rdbuf());
+    logger::warning(args...);
+    std::cerr.rdbuf(previous);
+    return captured.str();
+}
+
+func expect(const char* name, const std::string & line, const char* wanted) -> void
+{
+    bool found = line.find(wanted) != std::string::npos;
+    std::printf("%s: %s\n", name, found ? "ok" : "missing");
+    if (!found) {
+        std::printf("  expected \"%s\" in %s", wanted, line.c_str());
+        failures++;
+    }
+}
+
+int main()
+{
+    expect("literal", logged("<", "literal", ">"), "<literal>");
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "buffer %d", 42);
+    expect("char buffer", logged("<", buffer, ">"), "<buffer 42>");
+
+    char unterminated[4];
+    std::memcpy(unterminated, "abcd", sizeof(unterminated));
+    expect("unterminated char buffer", logged("<", unterminated, ">"), "<abcd>");
+
+    const char* pointer = buffer;
+    expect("pointer", logged("<", pointer, ">"), "<buffer 42>");
+
+    const char* null = nullptr;
+    expect("null pointer", logged("<", null, ">"), "<(null)>");
+
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}